@@ -0,0 +1,504 @@
+#ifndef _QTL_ARROW_H_
+#define _QTL_ARROW_H_
+
+#include <assert.h>
+#include <stdexcept>
+#include "qtl_common.hpp"
+
+/*
+	Structures of the Arrow C data interface.
+	They are defined by Arrow's abi.h too, which guards them with the same macro.
+ */
+#ifndef ARROW_C_DATA_INTERFACE
+#define ARROW_C_DATA_INTERFACE
+
+#define ARROW_FLAG_DICTIONARY_ORDERED 1
+#define ARROW_FLAG_NULLABLE 2
+#define ARROW_FLAG_MAP_KEYS_SORTED 4
+
+extern "C" {
+
+struct ArrowSchema
+{
+	// Array type description
+	const char* format;
+	const char* name;
+	const char* metadata;
+	int64_t flags;
+	int64_t n_children;
+	struct ArrowSchema** children;
+	struct ArrowSchema* dictionary;
+
+	// Release callback
+	void (*release)(struct ArrowSchema*);
+	// Opaque producer-specific data
+	void* private_data;
+};
+
+struct ArrowArray
+{
+	// Array data description
+	int64_t length;
+	int64_t null_count;
+	int64_t offset;
+	int64_t n_buffers;
+	int64_t n_children;
+	const void** buffers;
+	struct ArrowArray** children;
+	struct ArrowArray* dictionary;
+
+	// Release callback
+	void (*release)(struct ArrowArray*);
+	// Opaque producer-specific data
+	void* private_data;
+};
+
+}
+
+#endif // ARROW_C_DATA_INTERFACE
+
+namespace qtl
+{
+
+namespace arrow
+{
+
+enum class type
+{
+	null,
+	boolean,
+	int8, int16, int32, int64,
+	uint8, uint16, uint32, uint64,
+	float32, float64,
+	utf8, binary,
+	date32,			// days since 1970-01-01
+	time64,			// microseconds since midnight
+	timestamp,		// microseconds since 1970-01-01 00:00:00, without time zone
+	timestamp_utc,	// microseconds since 1970-01-01 00:00:00 UTC
+	duration		// microseconds
+};
+
+inline const char* format(type t)
+{
+	switch(t)
+	{
+	case type::null: return "n";
+	case type::boolean: return "b";
+	case type::int8: return "c";
+	case type::int16: return "s";
+	case type::int32: return "i";
+	case type::int64: return "l";
+	case type::uint8: return "C";
+	case type::uint16: return "S";
+	case type::uint32: return "I";
+	case type::uint64: return "L";
+	case type::float32: return "f";
+	case type::float64: return "g";
+	case type::utf8: return "u";
+	case type::binary: return "z";
+	case type::date32: return "tdD";
+	case type::time64: return "ttu";
+	case type::timestamp: return "tsu:";
+	case type::timestamp_utc: return "tsu:UTC";
+	case type::duration: return "tDu";
+	}
+	return "n";
+}
+
+// Returns the size of a value of fixed width types, otherwise 0.
+inline size_t value_size(type t)
+{
+	switch(t)
+	{
+	case type::int8:
+	case type::uint8:
+		return 1;
+	case type::int16:
+	case type::uint16:
+		return 2;
+	case type::int32:
+	case type::uint32:
+	case type::float32:
+	case type::date32:
+		return 4;
+	case type::int64:
+	case type::uint64:
+	case type::float64:
+	case type::time64:
+	case type::timestamp:
+	case type::timestamp_utc:
+	case type::duration:
+		return 8;
+	default:
+		return 0;
+	}
+}
+
+inline bool is_variable(type t)
+{
+	return t==type::utf8 || t==type::binary;
+}
+
+// Days since 1970-01-01 of a date of the proleptic Gregorian calendar.
+inline int32_t days_from_civil(int year, unsigned month, unsigned day)
+{
+	year-=month<=2;
+	const int era=(year>=0 ? year : year-399)/400;
+	const unsigned yoe=static_cast<unsigned>(year-era*400);
+	const unsigned doy=(153*(month+(month>2 ? -3 : 9))+2)/5+day-1;
+	const unsigned doe=yoe*365+yoe/4-yoe/100+doy;
+	return era*146097+static_cast<int32_t>(doe)-719468;
+}
+
+struct field
+{
+	std::string name;
+	arrow::type type;
+	bool nullable;
+
+	field(const char* n, arrow::type t, bool is_nullable=true)
+		: name(n ? n : ""), type(t), nullable(is_nullable) { }
+};
+
+namespace detail
+{
+
+// Buffers of zero length still need a valid address.
+inline const void* buffer_address(const void* data)
+{
+	static const int64_t empty=0;
+	return data ? data : &empty;
+}
+
+struct array_data
+{
+	std::vector<uint8_t> validity;
+	std::vector<uint8_t> values;
+	std::vector<int32_t> offsets;
+	std::vector<ArrowArray> children;
+	std::vector<ArrowArray*> child_pointers;
+	const void* buffers[3];
+};
+
+inline void release_array(ArrowArray* array)
+{
+	array_data* data=static_cast<array_data*>(array->private_data);
+	for(ArrowArray* child : data->child_pointers)
+	{
+		if(child->release) child->release(child);
+	}
+	delete data;
+	array->release=NULL;
+}
+
+struct schema_data
+{
+	std::vector<ArrowSchema> children;
+	std::vector<ArrowSchema*> child_pointers;
+};
+
+// A child owns its name, so it is still valid when the child is moved out of its parent.
+inline void release_child_schema(ArrowSchema* schema)
+{
+	delete static_cast<std::string*>(schema->private_data);
+	schema->private_data=NULL;
+	schema->release=NULL;
+}
+
+inline void release_schema(ArrowSchema* schema)
+{
+	schema_data* data=static_cast<schema_data*>(schema->private_data);
+	for(ArrowSchema* child : data->child_pointers)
+	{
+		if(child->release) child->release(child);
+	}
+	delete data;
+	schema->release=NULL;
+}
+
+}
+
+// Builds the buffers of one column of a batch.
+class column_builder
+{
+public:
+	explicit column_builder(arrow::type t) : m_type(t), m_length(0), m_null_count(0)
+	{
+		if(is_variable(m_type)) m_offsets.push_back(0);
+	}
+
+	arrow::type type() const { return m_type; }
+	size_t size() const { return m_length; }
+
+	void append_null()
+	{
+		if(m_type!=type::null)
+		{
+			append_validity(false);
+			if(is_variable(m_type))
+				m_offsets.push_back(m_offsets.back());
+			else if(m_type==type::boolean)
+				append_bit(m_values, false);
+			else
+				m_values.resize(m_values.size()+value_size(m_type));
+		}
+		++m_null_count;
+		++m_length;
+	}
+	void append(bool value)
+	{
+		assert(m_type==type::boolean);
+		append_validity(true);
+		append_bit(m_values, value);
+		++m_length;
+	}
+	// Appends a value of a fixed width type, T must have the width of the column type.
+	template<typename T>
+	void append(T value)
+	{
+		assert(sizeof(T)==value_size(m_type));
+		append_validity(true);
+		size_t n=m_values.size();
+		m_values.resize(n+sizeof(T));
+		memcpy(&m_values[n], &value, sizeof(T));
+		++m_length;
+	}
+	// Appends a value of utf8 or binary columns.
+	void append(const void* data, size_t size)
+	{
+		assert(is_variable(m_type));
+		if(m_values.size()+size>INT32_MAX)
+			throw std::length_error("too much data in a batch of arrow arrays.");
+		append_validity(true);
+		const uint8_t* bytes=static_cast<const uint8_t*>(data);
+		m_values.insert(m_values.end(), bytes, bytes+size);
+		m_offsets.push_back(static_cast<int32_t>(m_values.size()));
+		++m_length;
+	}
+
+	void reserve(size_t rows)
+	{
+		m_validity.reserve((rows+7)/8);
+		if(is_variable(m_type))
+			m_offsets.reserve(rows+1);
+		else
+			m_values.reserve(rows*value_size(m_type));
+	}
+	void clear()
+	{
+		m_validity.clear();
+		m_values.clear();
+		m_offsets.clear();
+		if(is_variable(m_type)) m_offsets.push_back(0);
+		m_length=0;
+		m_null_count=0;
+	}
+
+	// Moves the values to out and clears the column.
+	void release(ArrowArray* out)
+	{
+		detail::array_data* data=new detail::array_data;
+		data->validity.swap(m_validity);
+		data->values.swap(m_values);
+		data->offsets.swap(m_offsets);
+		out->length=m_length;
+		out->null_count=m_null_count;
+		out->offset=0;
+		out->n_children=0;
+		out->children=NULL;
+		out->dictionary=NULL;
+		out->buffers=data->buffers;
+		if(m_type==type::null)
+		{
+			out->n_buffers=0;
+		}
+		else
+		{
+			data->buffers[0]=m_null_count ? data->validity.data() : NULL;
+			if(is_variable(m_type))
+			{
+				out->n_buffers=3;
+				data->buffers[1]=data->offsets.data();
+				data->buffers[2]=detail::buffer_address(data->values.data());
+			}
+			else
+			{
+				out->n_buffers=2;
+				data->buffers[1]=detail::buffer_address(data->values.data());
+			}
+		}
+		out->release=detail::release_array;
+		out->private_data=data;
+		clear();
+	}
+
+private:
+	arrow::type m_type;
+	size_t m_length;
+	size_t m_null_count;
+	std::vector<uint8_t> m_validity;
+	std::vector<uint8_t> m_values;
+	std::vector<int32_t> m_offsets;
+
+	void append_bit(std::vector<uint8_t>& bitmap, bool value)
+	{
+		if(m_length%8==0) bitmap.push_back(0);
+		if(value) bitmap.back()|=1<<(m_length%8);
+	}
+	void append_validity(bool valid)
+	{
+		append_bit(m_validity, valid);
+	}
+};
+
+// Describes fields as the schema of a struct, which is the type of batches.
+inline void export_schema(const std::vector<field>& fields, ArrowSchema* out)
+{
+	detail::schema_data* data=new detail::schema_data;
+	data->children.resize(fields.size());
+	data->child_pointers.resize(fields.size());
+	for(size_t i=0; i!=fields.size(); i++)
+	{
+		std::string* name=new std::string(fields[i].name);
+		ArrowSchema& child=data->children[i];
+		child.format=format(fields[i].type);
+		child.name=name->c_str();
+		child.metadata=NULL;
+		child.flags=fields[i].nullable ? ARROW_FLAG_NULLABLE : 0;
+		child.n_children=0;
+		child.children=NULL;
+		child.dictionary=NULL;
+		child.release=detail::release_child_schema;
+		child.private_data=name;
+		data->child_pointers[i]=&child;
+	}
+	out->format="+s";
+	out->name="";
+	out->metadata=NULL;
+	out->flags=0;
+	out->n_children=static_cast<int64_t>(fields.size());
+	out->children=data->child_pointers.data();
+	out->dictionary=NULL;
+	out->release=detail::release_schema;
+	out->private_data=data;
+}
+
+// Moves the rows in columns to out as a struct array and clears the columns.
+inline void export_batch(std::vector<column_builder>& columns, size_t rows, ArrowArray* out)
+{
+	detail::array_data* data=new detail::array_data;
+	data->children.resize(columns.size());
+	data->child_pointers.resize(columns.size());
+	for(size_t i=0; i!=columns.size(); i++)
+	{
+		assert(columns[i].size()==rows);
+		columns[i].release(&data->children[i]);
+		data->child_pointers[i]=&data->children[i];
+	}
+	data->buffers[0]=NULL;
+	out->length=static_cast<int64_t>(rows);
+	out->null_count=0;
+	out->offset=0;
+	out->n_buffers=1;
+	out->n_children=static_cast<int64_t>(columns.size());
+	out->buffers=data->buffers;
+	out->children=data->child_pointers.data();
+	out->dictionary=NULL;
+	out->release=detail::release_array;
+	out->private_data=data;
+}
+
+/*
+	Reads the rows of an executed statement into batches of Arrow arrays.
+	Each backend derives T from this class, which provides:
+		bool fetch_row();
+			Moves to the next row and returns false when there are no more rows.
+			Columns are added by add_column before the first call returns.
+		void read_field(size_t col, column_builder& column);
+			Appends a field of the current row to the column.
+ */
+template<typename T>
+class basic_reader
+{
+public:
+	basic_reader(const basic_reader&) = delete;
+	basic_reader& operator=(const basic_reader&) = delete;
+
+	const std::vector<field>& fields()
+	{
+		prepare();
+		return m_fields;
+	}
+
+	// Describes the batches as a struct, out should be released by the caller.
+	void get_schema(ArrowSchema* out)
+	{
+		prepare();
+		export_schema(m_fields, out);
+	}
+
+	/*
+		Fetches at most max_rows rows into out as a struct array, out should be released by the caller.
+		Returns the count of fetched rows.
+		When there are no more rows, returns 0 and out is marked released.
+	 */
+	size_t read(ArrowArray* out, size_t max_rows=qtl::batch_size)
+	{
+		prepare();
+		T* pThis=static_cast<T*>(this);
+		size_t rows=0;
+		try
+		{
+			while(m_has_row && rows!=max_rows)
+			{
+				for(size_t i=0; i!=m_columns.size(); i++)
+					pThis->read_field(i, m_columns[i]);
+				++rows;
+				m_has_row=pThis->fetch_row();
+			}
+		}
+		catch(...)
+		{
+			for(column_builder& column : m_columns)
+				column.clear();
+			throw;
+		}
+		if(rows==0)
+		{
+			out->release=NULL;
+			return 0;
+		}
+		export_batch(m_columns, rows, out);
+		return rows;
+	}
+
+protected:
+	basic_reader() : m_prepared(false), m_has_row(false) { }
+
+	void add_column(const char* name, arrow::type type, bool nullable=true)
+	{
+		m_fields.emplace_back(name, type, nullable);
+	}
+
+private:
+	std::vector<field> m_fields;
+	std::vector<column_builder> m_columns;
+	bool m_prepared;
+	bool m_has_row;
+
+	void prepare()
+	{
+		if(m_prepared) return;
+		m_has_row=static_cast<T*>(this)->fetch_row();
+		m_columns.reserve(m_fields.size());
+		for(const field& f : m_fields)
+			m_columns.emplace_back(f.type);
+		m_prepared=true;
+	}
+};
+
+}
+
+}
+
+#endif //_QTL_ARROW_H_
@@ -5,6 +5,7 @@
 #include <memory>
 #include <chrono>
 #include <functional>
+#include "qtl_trace.hpp"
 
 namespace qtl
 {
@@ -21,8 +22,8 @@ namespace detail
 template<typename Values, typename RowHandler, typename FinishHandler>
 struct async_fetch_helper : public std::enable_shared_from_this<async_fetch_helper<Values, RowHandler, FinishHandler>>
 {
-	async_fetch_helper(const Values& values, const RowHandler& row_handler, const FinishHandler& finish_handler)
-		: m_values(values), m_row_handler(row_handler), m_finish_handler(finish_handler), m_auto_close_command(true)
+	async_fetch_helper(const Values& values, const RowHandler& row_handler, const FinishHandler& finish_handler, const query_trace& trace)
+		: m_values(values), m_row_handler(row_handler), m_finish_handler(finish_handler), m_trace(trace), m_auto_close_command(true)
 	{
 	}
 
@@ -30,9 +31,13 @@ struct async_fetch_helper : public std::enable_shared_from_this<async_fetch_help
 	void start(const std::shared_ptr<Command>& command)
 	{
 		auto self = this->shared_from_this();
+		m_trace.start(query_phase::fetch);
 		command->fetch(std::forward<Values>(m_values), [this, command]() {
+			m_trace.row();
+			qtl::complete_fetch(m_values);
 			return qtl::detail::apply<RowHandler, Values>(std::forward<RowHandler>(m_row_handler), std::forward<Values>(m_values));
 		}, [self, command](const Exception& e) {
+			self->m_trace.finish(e ? true : false);
 			if (e || self->m_auto_close_command)
 			{
 				command->close([self, command, e](const Exception& new_e) {
@@ -55,30 +60,31 @@ private:
 	Values m_values;
 	RowHandler m_row_handler;
 	FinishHandler m_finish_handler;
+	query_trace m_trace;
 	bool m_auto_close_command;
 };
 
 template<typename Values, typename RowHandler, typename FinishHandler>
-inline std::shared_ptr<async_fetch_helper<Values, RowHandler, FinishHandler>> make_fetch_helper(const Values& values, const RowHandler& row_handler, const FinishHandler& cpmplete_handler)
+inline std::shared_ptr<async_fetch_helper<Values, RowHandler, FinishHandler>> make_fetch_helper(const Values& values, const RowHandler& row_handler, const FinishHandler& cpmplete_handler, const query_trace& trace)
 {
-	return std::make_shared<async_fetch_helper<Values, RowHandler, FinishHandler>>(values, row_handler, cpmplete_handler);
+	return std::make_shared<async_fetch_helper<Values, RowHandler, FinishHandler>>(values, row_handler, cpmplete_handler, trace);
 }
 
 
 template<typename Exception, typename Command, typename RowHandler, typename FinishHandler>
-inline void async_fetch_command(const std::shared_ptr<Command>& command, FinishHandler&& finish_handler, RowHandler&& row_handler)
+inline void async_fetch_command(const std::shared_ptr<Command>& command, const query_trace& trace, FinishHandler&& finish_handler, RowHandler&& row_handler)
 {
 	auto values=make_values(row_handler);
 	typedef decltype(values) values_type;
-	auto helper = make_fetch_helper(std::forward<values_type>(values), std::forward<RowHandler>(row_handler), std::forward<FinishHandler>(finish_handler));
+	auto helper = make_fetch_helper(std::forward<values_type>(values), std::forward<RowHandler>(row_handler), std::forward<FinishHandler>(finish_handler), trace);
 	helper->auto_close_command(false);
 	helper->template start<Command, Exception>(command);
 }
 
 template<typename Exception, typename Command, typename RowHandler, typename FinishHandler, typename... OtherHandler>
-inline void async_fetch_command(const std::shared_ptr<Command>& command, FinishHandler&& finish_handler, RowHandler&& row_handler, OtherHandler&&... other)
+inline void async_fetch_command(const std::shared_ptr<Command>& command, const query_trace& trace, FinishHandler&& finish_handler, RowHandler&& row_handler, OtherHandler&&... other)
 {
-	async_fetch_command<Exception>(command, [command, finish_handler, other...](const Exception& e) mutable {
+	async_fetch_command<Exception>(command, trace, [command, trace, finish_handler, other...](const Exception& e) mutable {
 		if (e)
 		{
 			finish_handler(e);
@@ -89,7 +95,7 @@ inline void async_fetch_command(const std::shared_ptr<Command>& command, FinishH
 				if (e)
 					finish_handler(e);
 				else
-					async_fetch_command<Exception>(command, std::forward<FinishHandler>(finish_handler), std::forward<OtherHandler>(other)...);
+					async_fetch_command<Exception>(command, trace, std::forward<FinishHandler>(finish_handler), std::forward<OtherHandler>(other)...);
 			});
 		}
 	}, std::forward<RowHandler>(row_handler));
@@ -160,7 +166,10 @@ public:
 	void execute(ResultHandler handler, const char* query_text, size_t text_length, const Params& params)
 	{
 		T* pThis = static_cast<T*>(this);
-		pThis->open_command(query_text, text_length, [handler, params](const typename T::exception_type& e, std::shared_ptr<Command>& command) mutable {
+		detail::query_trace trace(query_text, text_length, detail::param_count<Params>::value);
+		trace.start(query_phase::prepare);
+		pThis->open_command(query_text, text_length, [handler, params, trace](const typename T::exception_type& e, std::shared_ptr<Command>& command) mutable {
+			trace.finish(e ? true : false);
 			if(e)
 			{
 				command->close([command, e, handler](const typename T::exception_type& ae) mutable {
@@ -168,7 +177,9 @@ public:
 				});
 				return;
 			}
-			command->execute(params, [command, handler](const typename T::exception_type& e, uint64_t affected) mutable {
+			trace.start(query_phase::execute);
+			command->execute(params, [command, handler, trace](const typename T::exception_type& e, uint64_t affected) mutable {
+				trace.finish(e ? true : false);
 				command->close([command, handler, e, affected](const typename T::exception_type& ae) mutable {
 					handler(e ? e : ae, affected);
 				});
@@ -214,7 +225,10 @@ public:
 	void insert(ResultHandler handler, const char* query_text, size_t text_length, const Params& params)
 	{
 		T* pThis = static_cast<T*>(this);
-		pThis->open_command(query_text, text_length, [handler, params](const typename T::exception_type& e, std::shared_ptr<Command>& command) {
+		detail::query_trace trace(query_text, text_length, detail::param_count<Params>::value);
+		trace.start(query_phase::prepare);
+		pThis->open_command(query_text, text_length, [handler, params, trace](const typename T::exception_type& e, std::shared_ptr<Command>& command) mutable {
+			trace.finish(e ? true : false);
 			if(e)
 			{
 				command->close([command, e, handler](const typename T::exception_type& ae) mutable {
@@ -223,7 +237,9 @@ public:
 			}
 			else
 			{
-				command->execute(params, [command, handler](const typename T::exception_type& e, uint64_t affected) {
+				trace.start(query_phase::execute);
+				command->execute(params, [command, handler, trace](const typename T::exception_type& e, uint64_t affected) mutable {
+					trace.finish(e ? true : false);
 					auto insert_id = 0;
 					if(!e && affected>0)
 						insert_id  = command->insert_id();
@@ -277,15 +293,20 @@ public:
 	void query_explicit(const char* query_text, size_t text_length, const Params& params, Values&& values, RowHandler&& row_handler, FinishHandler&& finish_handler)
 	{
 		T* pThis = static_cast<T*>(this);
-		pThis->open_command(query_text, text_length, [values, row_handler, finish_handler, params](const typename T::exception_type& e, const std::shared_ptr<Command>& command) mutable {
+		detail::query_trace trace(query_text, text_length, detail::param_count<Params>::value);
+		trace.start(query_phase::prepare);
+		pThis->open_command(query_text, text_length, [values, row_handler, finish_handler, params, trace](const typename T::exception_type& e, const std::shared_ptr<Command>& command) mutable {
+			trace.finish(e ? true : false);
 			if(e)
 			{
 				finish_handler(e);
 			}
 			else
 			{
-				command->execute(params, [command, values, row_handler, finish_handler](const typename T::exception_type& e, uint64_t affected) mutable {
-					auto helper=detail::make_fetch_helper(values, row_handler, finish_handler);
+				trace.start(query_phase::execute);
+				command->execute(params, [command, values, row_handler, finish_handler, trace](const typename T::exception_type& e, uint64_t affected) mutable {
+					trace.finish(e ? true : false);
+					auto helper=detail::make_fetch_helper(values, row_handler, finish_handler, trace);
 					helper->template start<Command, typename T::exception_type>(command);
 				});
 			}
@@ -353,18 +374,23 @@ public:
 	void query_multi_with_params(const char* query_text, size_t text_length, const Params& params, FinishHandler&& finish_handler, RowHandlers&&... row_handlers)
 	{
 		T* pThis = static_cast<T*>(this);
-		pThis->open_command(query_text, text_length, [params, finish_handler, row_handlers...](const typename T::exception_type& e, const std::shared_ptr<Command>& command) mutable {
+		detail::query_trace trace(query_text, text_length, detail::param_count<Params>::value);
+		trace.start(query_phase::prepare);
+		pThis->open_command(query_text, text_length, [params, trace, finish_handler, row_handlers...](const typename T::exception_type& e, const std::shared_ptr<Command>& command) mutable {
+			trace.finish(e ? true : false);
 			if (e)
 			{
 				finish_handler(e);
 			}
 			else
 			{
+				trace.start(query_phase::execute);
 				command->execute(params, [=](const typename T::exception_type& e, uint64_t affected) mutable {
+					trace.finish(e ? true : false);
 					if (e)
 						finish_handler(e);
 					else
-						qtl::detail::async_fetch_command<typename T::exception_type>(command, std::forward<FinishHandler>(finish_handler), std::forward<RowHandlers>(row_handlers)...);
+						qtl::detail::async_fetch_command<typename T::exception_type>(command, trace, std::forward<FinishHandler>(finish_handler), std::forward<RowHandlers>(row_handlers)...);
 				});
 			}
 		});
@@ -18,9 +18,14 @@
 #include <memory>
 #include <string>
 #include <vector>
+#include <array>
+#include <list>
+#include <unordered_map>
 #include <functional>
 #include <algorithm>
+#include <iterator>
 #include "apply_tuple.h"
+#include "qtl_trace.hpp"
 
 #if ((defined(_MSVC_LANG) && _MSVC_LANG >= 201703L) || __cplusplus >= 201703L)
 #define _QTL_ENABLE_CPP17
@@ -30,6 +35,7 @@
 
 #if ((defined(_MSVC_LANG) && _MSVC_LANG >= 202002L) || __cplusplus >= 202002L)
 #define _QTL_ENABLE_CPP20
+#include <ranges>
 #endif 
 
 #if ((defined(_MSVC_LANG) && _MSVC_LANG >= 202604L) || __cplusplus >= 202400L)
@@ -60,6 +66,7 @@ struct const_blob_data
 };
 
 const size_t blob_buffer_size=64*1024;
+const size_t batch_size=1000;
 
 inline std::string& trim_string(std::string& str, const char* target)
 {
@@ -127,6 +134,7 @@ struct bind_string_helper
 	void assign(const char_type* str, size_t n) { m_value.assign(str, str+n); }
 	const char_type* data() const { return m_value.data(); }
 	size_t size() const { return m_value.size(); }
+	string_type& value() const { return m_value; }
 private:
 	string_type&& m_value;
 };
@@ -610,7 +618,7 @@ inline void fetch_command(Command& command, ValueProc&& proc)
 	typedef decltype(values) values_type;
 	while(command.fetch(std::forward<values_type>(values)))
 	{
-		if(!apply(std::forward<ValueProc>(proc), std::forward<values_type>(values)))
+		if(!qtl::detail::apply(std::forward<ValueProc>(proc), std::forward<values_type>(values)))
 			break;
 	}
 }
@@ -624,6 +632,30 @@ inline void fetch_command(Command& command, ValueProc&& proc, OtherProc&&... oth
 		fetch_command(command, std::forward<OtherProc>(other)...);
 	}
 }
+
+// Like fetch_command, and counts the rows of all result sets in trace.
+template<typename Command, typename ValueProc>
+inline void fetch_traced(Command& command, query_trace& trace, ValueProc&& proc)
+{
+	auto values=make_values(proc);
+	typedef decltype(values) values_type;
+	while(command.fetch(std::forward<values_type>(values)))
+	{
+		trace.row();
+		if(!qtl::detail::apply(std::forward<ValueProc>(proc), std::forward<values_type>(values)))
+			break;
+	}
+}
+
+template<typename Command, typename ValueProc, typename... OtherProc>
+inline void fetch_traced(Command& command, query_trace& trace, ValueProc&& proc, OtherProc&&... other)
+{
+	fetch_traced(command, trace, std::forward<ValueProc>(proc));
+	if(command.next_result())
+	{
+		fetch_traced(command, trace, std::forward<OtherProc>(other)...);
+	}
+}
 		
 #ifdef _QTL_ENABLE_CPP17
 
@@ -793,66 +825,255 @@ inline void bind_record(Command& command, T&& value)
 	binder(command, std::forward<T>(value));
 }
 
+/*
+	Called by statements before the first row of a result set is bound into a record.
+	Records which find their columns by name specialize this class to match the columns once for the result set.
+ */
+template<typename Command, typename T>
+struct record_planner
+{
+	void operator()(Command&, T&) const { }
+};
+
+template<typename Command, typename T>
+inline void plan_record(Command& command, T& value)
+{
+	record_planner<Command, typename std::remove_const<T>::type> planner;
+	planner(command, value);
+}
+
+/*
+	Called by statements after a row has been fetched into a record.
+	Records which collect rows instead of holding one specialize this class.
+ */
+template<typename T>
+struct fetch_completion
+{
+	void operator()(T&) const { }
+};
+
+template<typename T>
+inline void complete_fetch(T& value)
+{
+	fetch_completion<typename std::remove_const<T>::type> completion;
+	completion(value);
+}
+
+/*
+	Result sink which stores each column in a vector, 
+	with a bitmap of null values for each column.
+	Bit row%8 of byte row/8 in a bitmap is set when the field is null.
+	Fields are bound to one row of indicators, which is appended to the columns after each fetch, 
+	because some backends bind the addresses of fields only once per result set.
+ */
+template<typename... Types>
+class columnar
+{
+	static_assert(sizeof...(Types)>0, "columnar needs at least one column");
+public:
+	template<size_t N>
+	using column_type=typename std::tuple_element<N, std::tuple<Types...>>::type;
+	typedef std::vector<uint8_t> bitmap_type;
+
+	columnar() : m_size(0) { }
+
+	static constexpr size_t column_count() { return sizeof...(Types); }
+	size_t size() const { return m_size; }
+	bool empty() const { return m_size==0; }
+
+	template<size_t N>
+	std::vector<column_type<N>>& column() { return std::get<N>(m_columns); }
+	template<size_t N>
+	const std::vector<column_type<N>>& column() const { return std::get<N>(m_columns); }
+	const bitmap_type& null_bitmap(size_t col) const { return m_nulls[col]; }
+	bool is_null(size_t col, size_t row) const 
+	{
+		return (m_nulls[col][row/8]>>(row%8))&1;
+	}
+
+	void reserve(size_t rows)
+	{
+		reserve_columns(rows, std::integral_constant<size_t, sizeof...(Types)>());
+		for(bitmap_type& nulls : m_nulls)
+			nulls.reserve((rows+7)/8);
+	}
+	void clear()
+	{
+		clear_columns(std::integral_constant<size_t, sizeof...(Types)>());
+		for(bitmap_type& nulls : m_nulls)
+			nulls.clear();
+		m_size=0;
+	}
+
+	template<typename Command>
+	void bind(Command& command)
+	{
+		bind_columns(command, std::integral_constant<size_t, sizeof...(Types)>());
+	}
+	// Appends the fetched row to the columns.
+	void append()
+	{
+		if(m_size%8==0)
+		{
+			for(bitmap_type& nulls : m_nulls)
+				nulls.push_back(0);
+		}
+		append_columns(std::integral_constant<size_t, sizeof...(Types)>());
+		++m_size;
+	}
+
+private:
+	std::tuple<std::vector<Types>...> m_columns;
+	std::array<bitmap_type, sizeof...(Types)> m_nulls;
+	std::tuple<indicator<Types>...> m_row;
+	size_t m_size;
+
+	template<typename Command, size_t N>
+	void bind_columns(Command& command, std::integral_constant<size_t, N>)
+	{
+		bind_columns(command, std::integral_constant<size_t, N-1>());
+		qtl::bind_field(command, N-1, std::get<N-1>(m_row));
+	}
+	template<typename Command>
+	void bind_columns(Command&, std::integral_constant<size_t, 0>) { }
+
+	template<size_t N>
+	void append_columns(std::integral_constant<size_t, N>)
+	{
+		append_columns(std::integral_constant<size_t, N-1>());
+		// fields are copied, backends may bind the buffers of m_row once per result set
+		const indicator<column_type<N-1>>& field=std::get<N-1>(m_row);
+		std::get<N-1>(m_columns).push_back(field.data);
+		if(field.is_null)
+			m_nulls[N-1].back()|=1<<(m_size%8);
+	}
+	void append_columns(std::integral_constant<size_t, 0>) { }
+
+	template<size_t N>
+	void reserve_columns(size_t rows, std::integral_constant<size_t, N>)
+	{
+		reserve_columns(rows, std::integral_constant<size_t, N-1>());
+		std::get<N-1>(m_columns).reserve(rows);
+	}
+	void reserve_columns(size_t, std::integral_constant<size_t, 0>) { }
+
+	template<size_t N>
+	void clear_columns(std::integral_constant<size_t, N>)
+	{
+		clear_columns(std::integral_constant<size_t, N-1>());
+		std::get<N-1>(m_columns).clear();
+	}
+	void clear_columns(std::integral_constant<size_t, 0>) { }
+};
+
+template<typename Command, typename... Types>
+struct record_binder<Command, columnar<Types...>>
+{
+	void operator()(Command& command, columnar<Types...>&& values) const
+	{
+		values.bind(command);
+	}
+};
+
+template<typename Command, typename... Types>
+struct record_binder<Command, columnar<Types...>&>
+{
+	void operator()(Command& command, columnar<Types...>& values) const
+	{
+		values.bind(command);
+	}
+};
+
+template<typename... Types>
+struct fetch_completion<columnar<Types...>>
+{
+	void operator()(columnar<Types...>& values) const
+	{
+		values.append();
+	}
+};
+
+/*
+	Input iterator over the rows fetched by a command.
+	All copies of an iterator share the record it fetches into, 
+	so no memory is allocated per row.
+ */
 template<typename Command, typename Record>
 class query_iterator final
 {
 public:
-	using iterator_category = std::forward_iterator_tag;
+	using iterator_category = std::input_iterator_tag;
+#ifdef _QTL_ENABLE_CPP20
+	using iterator_concept = std::input_iterator_tag;
+#endif //C++20
 	using value_type = Record;
 	using difference_type = ptrdiff_t;
 	using pointer = Record*;
 	using reference = Record&;
 
+	query_iterator() : m_command(NULL), m_record(NULL), m_trace(NULL) { }
 	explicit query_iterator(Command& command) 
-		: m_command(command) { }
-	Record* operator->() const { return m_record.get(); }
+		: m_command(&command), m_record(NULL), m_trace(NULL) { }
+	query_iterator(Command& command, Record& record, detail::fetch_trace* trace=NULL)
+		: m_command(&command), m_record(&record), m_trace(trace) { }
+	Record* operator->() const { return m_record; }
 	Record& operator*() const { return *m_record; }
 
 	query_iterator& operator++()
 	{
-		if(!m_record)
-			m_record=std::make_shared<Record>();
-		if(m_record.use_count()==1)
+		if(m_record==NULL) return *this;
+		bool fetched;
+		try
 		{
-			if(!m_command.fetch(std::forward<Record>(*m_record)))
-				m_record.reset();
+			fetched=m_command->fetch(std::forward<Record>(*m_record));
+		}
+		catch(...)
+		{
+			if(m_trace) m_trace->finish(true);
+			throw;
+		}
+		if(fetched)
+		{
+			if(m_trace) m_trace->row();
 		}
 		else
 		{
-			std::shared_ptr<Record> record=std::make_shared<Record>();
-			if(m_command.fetch(std::forward<Record>(*record)))
-				m_record=record;
-			else
-				m_record.reset();
+			m_record=NULL;
+			if(m_trace) m_trace->finish();
 		}
 		return *this;
 	}
 	query_iterator operator++(int)
 	{
 		query_iterator temp=*this;
-		m_record=std::make_shared<Record>();
-		if(!m_command.fetch(std::forward<Record>(*m_record)))
-			m_record.reset();
+		++*this;
 		return temp;
 	}
 
-	bool operator ==(const query_iterator& rhs)
+	bool operator ==(const query_iterator& rhs) const
 	{
-		return &this->m_command==&rhs.m_command &&
-			this->m_record==rhs.m_record;
+		return this->m_record==rhs.m_record;
 	}
-	bool operator !=(const query_iterator& rhs)
+	bool operator !=(const query_iterator& rhs) const
 	{
 		return !(*this==rhs);
 	}
 
 private:
-	Command& m_command;
-	std::shared_ptr<Record> m_record;
+	Command* m_command;
+	Record* m_record;
+	detail::fetch_trace* m_trace;
 };
 
+/*
+	Owns the command of a query and the record which rows are fetched into.
+	The fetch phase of the query is traced from begin to the end of the rows, or until the result is destroyed.
+ */
 template<typename Command, typename Record>
 class query_result final
+#ifdef _QTL_ENABLE_CPP20
+	: public std::ranges::view_base
+#endif //C++20
 {
 public:
 	typedef typename query_iterator<Command, Record>::value_type value_type;
@@ -860,19 +1081,28 @@ public:
 	typedef typename query_iterator<Command, Record>::reference reference;
 	typedef query_iterator<Command, Record> iterator;
 
-	explicit query_result(Command&& command) : m_command(std::move(command)) { }
-	query_result(query_result&& src) : m_command(std::move(src.m_command)) { }
+	explicit query_result(Command&& command) 
+		: m_command(std::move(command)), m_trace(detail::query_trace("", 0, 0)) { }
+	query_result(Command&& command, detail::query_trace&& trace) 
+		: m_command(std::move(command)), m_trace(std::move(trace)) { }
+	query_result(query_result&& src) 
+		: m_command(std::move(src.m_command)), m_record(std::move(src.m_record)), m_trace(std::move(src.m_trace)) { }
 	query_result& operator=(query_result&& src)
 	{
 		if(this!=&src)
+		{
 			m_command=std::move(src.m_command);
+			m_record=std::move(src.m_record);
+			m_trace=std::move(src.m_trace);
+		}
 		return *this;
 	}
 
 	template<typename Params>
 	iterator begin(const Params& params)
 	{
-		query_iterator<Command, Record> it(m_command);
+		m_trace.start();
+		iterator it(m_command, m_record, &m_trace);
 		++it;
 		return it;
 	}
@@ -883,11 +1113,217 @@ public:
 
 	iterator end()
 	{
-		return query_iterator<Command, Record>(m_command);
+		return iterator(m_command);
 	}
 
 private:
 	Command m_command;
+	Record m_record;
+	detail::fetch_trace m_trace;
+};
+
+namespace detail
+{
+
+template<typename Command, typename Record, typename Alloc, typename RowProc>
+inline size_t fetch_n(Command& command, std::vector<Record, Alloc>& values, size_t count, RowProc&& proc)
+{
+	size_t rows=std::min<size_t>(command.get_row_count(), count);
+	if(rows>0) values.reserve(values.size()+rows);
+	Record record;
+	size_t fetched=0;
+	while(fetched!=count && command.fetch(std::forward<Record>(record)))
+	{
+		values.push_back(record);
+		++fetched;
+		proc();
+	}
+	return fetched;
+}
+
+}
+
+/*
+	Fetches at most count rows of command and appends them to values.
+	Rows are fetched into one record and copied to values,
+	since backends such as ODBC bind the buffers of the record once per result set.
+	Returns the number of fetched rows.
+ */
+template<typename Command, typename Record, typename Alloc>
+inline size_t fetch_n(Command& command, std::vector<Record, Alloc>& values, size_t count)
+{
+	return detail::fetch_n(command, values, count, []() { });
+}
+
+/*
+	Executes command with each element of a range of parameters, 
+	at most batch_size elements in a batch.
+	Backends which support sending a batch in one round trip specialize this class.
+ */
+template<typename Command>
+struct batch_executor
+{
+	template<typename Range>
+	std::vector<uint64_t> operator()(Command& command, const Range& params, size_t batch_size) const
+	{
+		std::vector<uint64_t> affected;
+		size_t count=0;
+		for(auto& param : params)
+		{
+			if(count++%batch_size==0) affected.push_back(0);
+			command.reset();
+			command.execute(param);
+			affected.back()+=command.affetced_rows();
+		}
+		return affected;
+	}
+};
+
+/*
+	Elements of params are bound as parameters, so they are tuples or records which specialize params_binder.
+	Returns the rows affected by each batch.
+ */
+template<typename Command, typename Range>
+inline std::vector<uint64_t> execute_batch(Command& command, const Range& params, size_t batch_size=qtl::batch_size)
+{
+	if(batch_size==0) batch_size=1;
+	return batch_executor<Command>()(command, params, batch_size);
+}
+
+/*
+	LRU cache of prepared statements, keyed by query text.
+	Command must support reset(), which returns it to the state just after preparing.
+ */
+template<typename Command>
+class statement_cache final
+{
+public:
+	struct statistics
+	{
+		uint64_t hits;
+		uint64_t misses;
+		uint64_t evictions;
+
+		statistics() : hits(0), misses(0), evictions(0) { }
+	};
+
+	// Returns an acquired statement to the cache when it goes out of scope.
+	class lease final
+	{
+	public:
+		lease(statement_cache& cache, Command* command) : m_cache(cache), m_command(command) { }
+		lease(const lease&) = delete;
+		lease& operator=(const lease&) = delete;
+		~lease()
+		{
+			m_cache.release(m_command);
+		}
+
+	private:
+		statement_cache& m_cache;
+		Command* m_command;
+	};
+
+	explicit statement_cache(size_t capacity=0) : m_capacity(capacity) { }
+	statement_cache(const statement_cache&) = delete;
+	statement_cache(statement_cache&&) = default;
+	statement_cache& operator=(const statement_cache&) = delete;
+	statement_cache& operator=(statement_cache&&) = default;
+
+	size_t capacity() const { return m_capacity; }
+	size_t size() const { return m_entries.size(); }
+	const statistics& stats() const { return m_stats; }
+
+	void set_capacity(size_t capacity)
+	{
+		m_capacity=capacity;
+		shrink(capacity);
+	}
+
+	void clear()
+	{
+		m_index.clear();
+		m_entries.clear();
+	}
+
+	// Returns the idle statement prepared from query_text, or NULL if there is none.
+	Command* acquire(const std::string& query_text)
+	{
+		auto it=m_index.find(query_text);
+		if(it==m_index.end() || it->second->busy)
+		{
+			++m_stats.misses;
+			return NULL;
+		}
+		++m_stats.hits;
+		m_entries.splice(m_entries.begin(), m_entries, it->second);
+		it->second->busy=true;
+		return &it->second->command;
+	}
+
+	/*
+		Moves command into the cache and returns it acquired.
+		If it can not be cached, returns NULL and command is left untouched.
+	 */
+	Command* insert(std::string&& query_text, Command& command)
+	{
+		if(m_capacity==0 || m_index.find(query_text)!=m_index.end())
+			return NULL;
+		shrink(m_capacity-1);
+		if(m_entries.size()>=m_capacity)
+			return NULL;
+		m_entries.emplace_front(std::move(query_text), std::move(command));
+		m_index.emplace(m_entries.front().query_text, m_entries.begin());
+		return &m_entries.front().command;
+	}
+
+	void release(Command* command) NOEXCEPT
+	{
+		auto it=std::find_if(m_entries.begin(), m_entries.end(), [command](const entry& e) {
+			return &e.command==command;
+		});
+		if(it==m_entries.end()) return;
+		try
+		{
+			it->command.reset();
+			it->busy=false;
+		}
+		catch(...)
+		{
+			m_index.erase(it->query_text);
+			m_entries.erase(it);
+		}
+	}
+
+private:
+	struct entry
+	{
+		std::string query_text;
+		Command command;
+		bool busy;
+
+		entry(std::string&& text, Command&& cmd) 
+			: query_text(std::move(text)), command(std::move(cmd)), busy(true) { }
+	};
+	std::list<entry> m_entries; // most recently used first
+	std::unordered_map<std::string, typename std::list<entry>::iterator> m_index;
+	size_t m_capacity;
+	statistics m_stats;
+
+	void shrink(size_t count)
+	{
+		auto it=m_entries.end();
+		while(m_entries.size()>count && it!=m_entries.begin())
+		{
+			--it;
+			if(!it->busy)
+			{
+				m_index.erase(it->query_text);
+				it=m_entries.erase(it);
+				++m_stats.evictions;
+			}
+		}
+	}
 };
 
 template<typename T, class Command>
@@ -897,12 +1333,12 @@ public:
 	template<typename Params>
 	T& execute(const char* query_text, size_t text_length, const Params& params, uint64_t* affected=NULL)
 	{
-		T* pThis=static_cast<T*>(this);
-		Command command=pThis->open_command(query_text, text_length);
-		command.execute(params);
-		if(affected) *affected=command.affetced_rows();
-		command.close();
-		return *pThis;
+		detail::query_trace trace(query_text, text_length, detail::param_count<Params>::value);
+		use_command(query_text, text_length, trace, [&params, affected, &trace](Command& command) {
+			execute_command(command, params, trace);
+			if(affected) *affected=command.affetced_rows();
+		});
+		return *static_cast<T*>(this);
 	}
 	template<typename Params>
 	T& execute(const char* query_text, const Params& params, uint64_t* affected=NULL)
@@ -931,15 +1367,40 @@ public:
 		return execute(query_text, std::forward_as_tuple(params...), affected);
 	}
 
+	template<typename Range>
+	std::vector<uint64_t> execute_batch(const char* query_text, size_t text_length, const Range& params, size_t batch_size=qtl::batch_size)
+	{
+		typedef typename std::decay<decltype(*std::begin(params))>::type param_type;
+		std::vector<uint64_t> affected;
+		detail::query_trace trace(query_text, text_length, detail::param_count<param_type>::value);
+		use_command(query_text, text_length, trace, [&params, batch_size, &affected, &trace](Command& command) {
+			detail::query_trace::guard guard(trace, query_phase::execute);
+			affected=qtl::execute_batch(command, params, batch_size);
+			guard.finish();
+		});
+		return affected;
+	}
+	template<typename Range>
+	std::vector<uint64_t> execute_batch(const char* query_text, const Range& params, size_t batch_size=qtl::batch_size)
+	{
+		return execute_batch(query_text, strlen(query_text), params, batch_size);
+	}
+	template<typename Range>
+	std::vector<uint64_t> execute_batch(const std::string& query_text, const Range& params, size_t batch_size=qtl::batch_size)
+	{
+		return execute_batch(query_text.data(), query_text.length(), params, batch_size);
+	}
+
 	template<typename Params>
 	uint64_t insert(const char* query_text, size_t text_length, const Params& params)
 	{
 		uint64_t id=0;
-		T* pThis=static_cast<T*>(this);
-		Command command=pThis->open_command(query_text, text_length);
-		command.execute(params);
-		if(command.affetced_rows()>0)
-			id=command.insert_id();
+		detail::query_trace trace(query_text, text_length, detail::param_count<Params>::value);
+		use_command(query_text, text_length, trace, [&params, &id, &trace](Command& command) {
+			execute_command(command, params, trace);
+			if(command.affetced_rows()>0)
+				id=command.insert_id();
+		});
 		return id;
 	}
 
@@ -976,10 +1437,10 @@ public:
 	template<typename Record, typename Params>
 	query_result<Command, Record> result(const char* query_text, size_t text_length, const Params& params)
 	{
-		T* pThis=static_cast<T*>(this);
-		Command command=pThis->open_command(query_text, text_length);
-		command.execute(params);
-		return query_result<Command, Record>(std::move(command));
+		detail::query_trace trace(query_text, text_length, detail::param_count<Params>::value);
+		Command command=prepare_command(query_text, text_length, trace);
+		execute_command(command, params, trace);
+		return query_result<Command, Record>(std::move(command), std::move(trace));
 	}
 	template<typename Record, typename Params>
 	query_result<Command, Record> result(const char* query_text, const Params& params)
@@ -1010,15 +1471,18 @@ public:
 	template<typename Params, typename Values, typename ValueProc>
 	T& query_explicit(const char* query_text, size_t text_length, const Params& params, Values&& values, ValueProc&& proc)
 	{
-		T* pThis=static_cast<T*>(this);
-		Command command=pThis->open_command(query_text, text_length);
-		command.execute(params);
-		while(command.fetch(std::forward<Values>(values)))
-		{
-			if(!detail::apply(std::forward<ValueProc>(proc), std::forward<Values>(values))) break;
-		}
-		command.close();
-		return *pThis;
+		detail::query_trace trace(query_text, text_length, detail::param_count<Params>::value);
+		use_command(query_text, text_length, trace, [&params, &values, &proc, &trace](Command& command) {
+			execute_command(command, params, trace);
+			detail::query_trace::guard guard(trace, query_phase::fetch);
+			while(command.fetch(std::forward<Values>(values)))
+			{
+				trace.row();
+				if(!detail::apply(std::forward<ValueProc>(proc), std::forward<Values>(values))) break;
+			}
+			guard.finish();
+		});
+		return *static_cast<T*>(this);
 	}
 
 	template<typename Params, typename Values, typename ValueProc>
@@ -1047,6 +1511,44 @@ public:
 		return query_explicit(query_text, std::make_tuple(), std::forward<Values>(values), std::forward<ValueProc>(proc));
 	}
 
+	template<typename Params, typename Record, typename Alloc>
+	T& query_all(const char* query_text, size_t text_length, const Params& params, std::vector<Record, Alloc>& values)
+	{
+		detail::query_trace trace(query_text, text_length, detail::param_count<Params>::value);
+		use_command(query_text, text_length, trace, [&params, &values, &trace](Command& command) {
+			execute_command(command, params, trace);
+			detail::query_trace::guard guard(trace, query_phase::fetch);
+			detail::fetch_n(command, values, SIZE_MAX, [&trace]() { trace.row(); });
+			guard.finish();
+		});
+		return *static_cast<T*>(this);
+	}
+	template<typename Params, typename Record, typename Alloc>
+	T& query_all(const char* query_text, const Params& params, std::vector<Record, Alloc>& values)
+	{
+		return query_all(query_text, strlen(query_text), params, values);
+	}
+	template<typename Params, typename Record, typename Alloc>
+	T& query_all(const std::string& query_text, const Params& params, std::vector<Record, Alloc>& values)
+	{
+		return query_all(query_text.data(), query_text.size(), params, values);
+	}
+	template<typename Record, typename Alloc>
+	T& query_all(const char* query_text, size_t text_length, std::vector<Record, Alloc>& values)
+	{
+		return query_all(query_text, text_length, std::make_tuple(), values);
+	}
+	template<typename Record, typename Alloc>
+	T& query_all(const char* query_text, std::vector<Record, Alloc>& values)
+	{
+		return query_all(query_text, strlen(query_text), std::make_tuple(), values);
+	}
+	template<typename Record, typename Alloc>
+	T& query_all(const std::string& query_text, std::vector<Record, Alloc>& values)
+	{
+		return query_all(query_text.data(), query_text.size(), std::make_tuple(), values);
+	}
+
 	template<typename Params, typename ValueProc>
 	T& query(const char* query_text, size_t text_length, const Params& params, ValueProc&& proc)
 	{
@@ -1081,12 +1583,14 @@ public:
 	template<typename Params, typename... ValueProc>
 	T& query_multi_with_params(const char* query_text, size_t text_length, const Params& params, ValueProc&&... proc)
 	{
-		T* pThis=static_cast<T*>(this);
-		Command command=pThis->open_command(query_text, text_length);
-		command.execute(params);
-		detail::fetch_command(command, std::forward<ValueProc>(proc)...);
+		detail::query_trace trace(query_text, text_length, detail::param_count<Params>::value);
+		Command command=prepare_command(query_text, text_length, trace);
+		execute_command(command, params, trace);
+		detail::query_trace::guard guard(trace, query_phase::fetch);
+		detail::fetch_traced(command, trace, std::forward<ValueProc>(proc)...);
+		guard.finish();
 		command.close();
-		return *this;
+		return *static_cast<T*>(this);
 	}
 	template<typename Params, typename... ValueProc>
 	T& query_multi_with_params(const char* query_text, const Params& params, ValueProc&&... proc)
@@ -1180,7 +1684,80 @@ public:
 		return query_first(query_text, std::tie(values...));
 	}
 
+	/*
+		Statements prepared by execute, insert, query_explicit, query and query_first 
+		are kept in a LRU cache of capacity statements and reused.
+		The cache is disabled when capacity is 0, which is the default.
+	 */
+	void set_statement_cache_size(size_t capacity)
+	{
+		m_statement_cache.set_capacity(capacity);
+	}
+	size_t statement_cache_size() const
+	{
+		return m_statement_cache.capacity();
+	}
+	const typename statement_cache<Command>::statistics& statement_cache_stats() const
+	{
+		return m_statement_cache.stats();
+	}
+	void clear_statement_cache()
+	{
+		m_statement_cache.clear();
+	}
+	// A database hides it to bypass the cache while its statements can not be reused.
+	bool can_cache_statements() const { return true; }
+
 protected:
+	statement_cache<Command> m_statement_cache;
+
+	Command prepare_command(const char* query_text, size_t text_length, detail::query_trace& trace)
+	{
+		T* pThis=static_cast<T*>(this);
+		detail::query_trace::guard guard(trace, query_phase::prepare);
+		Command command=pThis->open_command(query_text, text_length);
+		guard.finish();
+		return command;
+	}
+
+	template<typename Params>
+	static void execute_command(Command& command, const Params& params, detail::query_trace& trace)
+	{
+		detail::query_trace::guard guard(trace, query_phase::execute);
+		command.execute(params);
+		guard.finish();
+	}
+
+	template<typename CommandProc>
+	void use_command(const char* query_text, size_t text_length, detail::query_trace& trace, CommandProc&& proc)
+	{
+		T* pThis=static_cast<T*>(this);
+		if(m_statement_cache.capacity()>0 && pThis->can_cache_statements())
+		{
+			std::string key(query_text, text_length);
+			Command* cached=m_statement_cache.acquire(key);
+			if(cached==NULL)
+			{
+				Command command=prepare_command(query_text, text_length, trace);
+				cached=m_statement_cache.insert(std::move(key), command);
+				if(cached==NULL)
+				{
+					proc(command);
+					command.close();
+					return;
+				}
+			}
+			typename statement_cache<Command>::lease lease(m_statement_cache, cached);
+			proc(*cached);
+		}
+		else
+		{
+			Command command=prepare_command(query_text, text_length, trace);
+			proc(command);
+			command.close();
+		}
+	}
+
 	struct nothing 
 	{
 		template<typename... Values> bool operator()(Values&&...) const {  return true; }
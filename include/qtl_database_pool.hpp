@@ -7,11 +7,161 @@
 #include <thread>
 #include <mutex>
 #include <chrono>
+#include <deque>
+#include <condition_variable>
+#include <functional>
 #include <algorithm>
+#include <stdint.h>
 
 namespace qtl
 {
 
+// Histogram of durations, bucket i counts durations shorter than 10^(i+1) microseconds, the last bucket counts the rest.
+struct duration_histogram
+{
+	enum { bucket_count=8 };
+
+	uint64_t buckets[bucket_count];
+	uint64_t count;
+	std::chrono::microseconds total;
+	std::chrono::microseconds max;
+};
+
+// Snapshot of the state of a pool, counters are accumulated since the pool is created.
+struct pool_metrics
+{
+	size_t idle;
+	size_t in_use;
+	size_t creating;
+	size_t waiting;
+	duration_histogram acquire_time; // time spent in get, including waiting and connecting
+	uint64_t acquire_failures; // get returned no connection
+	duration_histogram connect_time; // time of successful connects
+	uint64_t failed_connects;
+	uint64_t validations;
+	uint64_t failed_validations;
+	uint64_t evictions;
+};
+
+namespace detail
+{
+
+class atomic_histogram
+{
+public:
+	atomic_histogram() : m_count(0), m_total(0), m_max(0)
+	{
+		for(std::atomic<uint64_t>& bucket : m_buckets)
+			bucket=0;
+	}
+
+	void record(std::chrono::steady_clock::duration duration)
+	{
+		uint64_t value=std::chrono::duration_cast<std::chrono::microseconds>(duration).count();
+		size_t index=0;
+		for(uint64_t limit=10; index+1<duration_histogram::bucket_count && value>=limit; limit*=10)
+			++index;
+		m_buckets[index].fetch_add(1, std::memory_order_relaxed);
+		m_count.fetch_add(1, std::memory_order_relaxed);
+		m_total.fetch_add(value, std::memory_order_relaxed);
+		uint64_t max=m_max.load(std::memory_order_relaxed);
+		while(value>max && !m_max.compare_exchange_weak(max, value, std::memory_order_relaxed));
+	}
+
+	void snapshot(duration_histogram& histogram) const
+	{
+		for(size_t i=0; i!=duration_histogram::bucket_count; i++)
+			histogram.buckets[i]=m_buckets[i].load(std::memory_order_relaxed);
+		histogram.count=m_count.load(std::memory_order_relaxed);
+		histogram.total=std::chrono::microseconds(m_total.load(std::memory_order_relaxed));
+		histogram.max=std::chrono::microseconds(m_max.load(std::memory_order_relaxed));
+	}
+
+private:
+	std::atomic<uint64_t> m_buckets[duration_histogram::bucket_count];
+	std::atomic<uint64_t> m_count;
+	std::atomic<uint64_t> m_total;
+	std::atomic<uint64_t> m_max;
+};
+
+// Counters of a pool, they are updated without locks and read by pool_metrics snapshots.
+class pool_statistics
+{
+public:
+	typedef std::chrono::steady_clock clock;
+
+	pool_statistics() : m_creating(0), m_acquire_failures(0), m_failed_connects(0),
+		m_validations(0), m_failed_validations(0), m_evictions(0) { }
+
+	void acquired(clock::time_point start, bool succeeded)
+	{
+		m_acquire_time.record(clock::now()-start);
+		if(!succeeded) m_acquire_failures.fetch_add(1, std::memory_order_relaxed);
+	}
+	clock::time_point connecting()
+	{
+		m_creating.fetch_add(1, std::memory_order_relaxed);
+		return clock::now();
+	}
+	void connected(clock::time_point start, bool succeeded)
+	{
+		if(succeeded)
+			m_connect_time.record(clock::now()-start);
+		else
+			m_failed_connects.fetch_add(1, std::memory_order_relaxed);
+		m_creating.fetch_sub(1, std::memory_order_relaxed);
+	}
+	void validated(bool succeeded)
+	{
+		m_validations.fetch_add(1, std::memory_order_relaxed);
+		if(!succeeded) m_failed_validations.fetch_add(1, std::memory_order_relaxed);
+	}
+	void evicted(size_t count)
+	{
+		m_evictions.fetch_add(count, std::memory_order_relaxed);
+	}
+
+	// Fills counters of metrics, and in_use from the count of open connections.
+	void snapshot(pool_metrics& metrics, size_t size, size_t idle, size_t waiting) const
+	{
+		metrics.idle=idle;
+		metrics.creating=m_creating.load(std::memory_order_relaxed);
+		metrics.waiting=waiting;
+		// counters are read one by one, so they may be a little inconsistent
+		metrics.in_use=size>idle+metrics.creating ? size-idle-metrics.creating : 0;
+		m_acquire_time.snapshot(metrics.acquire_time);
+		metrics.acquire_failures=m_acquire_failures.load(std::memory_order_relaxed);
+		m_connect_time.snapshot(metrics.connect_time);
+		metrics.failed_connects=m_failed_connects.load(std::memory_order_relaxed);
+		metrics.validations=m_validations.load(std::memory_order_relaxed);
+		metrics.failed_validations=m_failed_validations.load(std::memory_order_relaxed);
+		metrics.evictions=m_evictions.load(std::memory_order_relaxed);
+	}
+
+private:
+	std::atomic<size_t> m_creating;
+	atomic_histogram m_acquire_time;
+	std::atomic<uint64_t> m_acquire_failures;
+	atomic_histogram m_connect_time;
+	std::atomic<uint64_t> m_failed_connects;
+	std::atomic<uint64_t> m_validations;
+	std::atomic<uint64_t> m_failed_validations;
+	std::atomic<uint64_t> m_evictions;
+};
+
+template<typename Connection>
+struct idle_connection
+{
+	Connection* db;
+	std::chrono::steady_clock::time_point since;
+
+	idle_connection() : db(NULL) { }
+	explicit idle_connection(Connection* connection)
+		: db(connection), since(std::chrono::steady_clock::now()) { }
+};
+
+}
+
 template<typename Database>
 class database_pool
 {
@@ -20,15 +170,29 @@ public:
 	typedef std::shared_ptr<Database> pointer;
 
 	database_pool()
-		: m_trying_connection(false), m_stop_thread(false)
+		: m_min_size(0), m_max_size(SIZE_MAX), m_size(0), m_validate_after(std::chrono::seconds(30)), m_idle_timeout(0),
+		m_check_concurrency(4), m_check_timeout(std::chrono::seconds(5)), m_waiting(0), m_trying_connection(false), m_stop_thread(false),
+		m_link(std::make_shared<pool_link>(this))
 	{
+		m_shard_count=std::max(1u, std::min(std::thread::hardware_concurrency(), 16u));
+		m_shards.reset(new shard[m_shard_count]);
 	}
 
 	virtual ~database_pool()
 	{
-		if(m_background_thread.joinable())
 		{
+			std::lock_guard<std::mutex> lock(m_link->mutex);
+			m_link->pool=NULL;
+		}
+		{
+			std::lock_guard<std::mutex> lock(m_maintenance_mutex);
 			m_stop_thread=true;
+			m_maintenance_cv.notify_all();
+		}
+		if(m_maintenance_thread.joinable())
+			m_maintenance_thread.join();
+		if(m_background_thread.joinable())
+		{
 			try
 			{
 				m_background_thread.join();
@@ -41,105 +205,429 @@ public:
 		clear();
 	}
 
-	pointer get()
+	/*
+		The pool opens at most max_size connections, the default is unlimited.
+		When the connection to the server is lost, at least min_size connections are reopened in background.
+	 */
+	void set_size_limits(size_t min_size, size_t max_size)
 	{
-		Database* db=popup();
-		if(db==NULL && m_trying_connection==false)
-			db=create_database();
-		return pointer(db, [this](Database* db) {
-			recovery(db);
-		});
+		m_max_size=std::max<size_t>(max_size, 1);
+		m_min_size=std::min(min_size, m_max_size.load());
 	}
+	size_t min_size() const { return m_min_size; }
+	size_t max_size() const { return m_max_size; }
+	// Count of open connections, including connections in use.
+	size_t size() const { return m_size; }
 
-	bool test_alive()
+	/*
+		A connection idle for at least this time is checked by is_alive before it is handed out, the default is 30 seconds.
+		Connections are not checked when they are returned, so a short query costs no extra round trip.
+		Set it before the pool is used.
+	 */
+	template<typename Rep, typename Period>
+	void set_validate_after(const std::chrono::duration<Rep, Period>& idle_time)
 	{
-		if(m_databases.empty()) 
-			return false;
-		std::unique_lock<std::mutex> lock(m_pool_mutex);
-		auto it=m_databases.begin();
-		while(it!=m_databases.end())
+		m_validate_after=std::chrono::duration_cast<std::chrono::milliseconds>(idle_time);
+	}
+
+	/*
+		Connections idle for longer than timeout are closed by a background thread, until min_size connections remain.
+		A zero timeout, which is the default, keeps idle connections open.
+	 */
+	template<typename Rep, typename Period>
+	void set_idle_timeout(const std::chrono::duration<Rep, Period>& timeout)
+	{
+		std::lock_guard<std::mutex> lock(m_maintenance_mutex);
+		m_idle_timeout=std::chrono::duration_cast<std::chrono::milliseconds>(timeout);
+		if(m_idle_timeout.count()>0 && !m_maintenance_thread.joinable())
+			m_maintenance_thread=std::thread(&database_pool<Database>::maintain, this);
+		m_maintenance_cv.notify_all();
+	}
+
+	// Opens connections up to min_size in parallel, returns false if any of them can not be opened.
+	bool warm_up()
+	{
+		std::atomic<bool> succeeded(true);
+		std::vector<std::thread> threads;
+		while(m_size<m_min_size && reserve_slot())
 		{
-			Database* db=*it;
-			if(!db->is_alive())
+			try
 			{
-				delete db;
-				it=m_databases.erase(it);
+				threads.emplace_back([this, &succeeded]() {
+					Database* db=open_database();
+					if(db)
+					{
+						push(db);
+					}
+					else
+					{
+						release_slot();
+						succeeded=false;
+					}
+				});
 			}
-			else
+			catch (std::system_error&)
 			{
-				++it;
+				release_slot();
+				succeeded=false;
+				break;
 			}
 		}
-		if(m_databases.empty())
+		for(std::thread& thread : threads)
+			thread.join();
+		return succeeded;
+	}
+
+	/*
+		Returns an idle or a new connection, or an empty pointer if the pool is exhausted or the server is unreachable.
+		It does not take a connection while other threads are waiting for one.
+	 */
+	pointer get()
+	{
+		detail::pool_statistics::clock::time_point start=detail::pool_statistics::clock::now();
+		Database* db=m_waiting>0 ? NULL : acquire();
+		m_statistics.acquired(start, db!=NULL);
+		return wrap(db);
+	}
+
+	/*
+		Waits at most timeout for a connection if the pool is exhausted.
+		Waiting threads are served in the order of their arrival.
+	 */
+	template<typename Rep, typename Period>
+	pointer get(const std::chrono::duration<Rep, Period>& timeout)
+	{
+		detail::pool_statistics::clock::time_point start=detail::pool_statistics::clock::now();
+		Database* db=m_waiting>0 ? NULL : acquire();
+		if(db==NULL)
+			db=wait(start+timeout);
+		m_statistics.acquired(start, db!=NULL);
+		return wrap(db);
+	}
+
+	// It does not lock the pool, so it can be called frequently by a monitoring thread.
+	pool_metrics metrics() const
+	{
+		size_t idle=0;
+		for(size_t i=0; i!=m_shard_count; i++)
+			idle+=m_shards[i].count;
+		pool_metrics result;
+		m_statistics.snapshot(result, m_size, idle, m_waiting);
+		return result;
+	}
+
+	/*
+		Checks idle connections, at most concurrency checks run at the same time, the default is 4.
+		A check not finished within timeout, which is 5 seconds by default, counts as a failure.
+	 */
+	template<typename Rep, typename Period>
+	void set_check_options(size_t concurrency, const std::chrono::duration<Rep, Period>& timeout)
+	{
+		m_check_concurrency=std::max<size_t>(concurrency, 1);
+		m_check_timeout=std::chrono::duration_cast<std::chrono::milliseconds>(timeout);
+	}
+
+	/*
+		Checks the connections idle when it is called, and closes the dead ones.
+		A connection is taken out of the pool only while it is checked, so other threads can get connections meanwhile.
+		Returns false if no connection is alive.
+	 */
+	bool test_alive()
+	{
+		std::chrono::steady_clock::time_point start=std::chrono::steady_clock::now();
+		std::deque<std::shared_ptr<alive_check>> running;
+		size_t checked=0, alive=0;
+		for(;;)
 		{
-			lock.unlock();
-			try_connect();
-			return false;
+			while(running.size()<m_check_concurrency)
+			{
+				Database* db=checkout(start);
+				if(db==NULL) break;
+				running.push_back(start_check(db));
+			}
+			if(running.empty()) break;
+
+			std::shared_ptr<alive_check> check=running.front();
+			running.pop_front();
+			++checked;
+			if(finish_check(*check))
+				++alive;
 		}
-		else return true;
+		if(checked>0 && alive==0)
+			try_connect();
+		return alive>0;
 	}
 
 private:
-	std::vector<Database*> m_databases;
-	std::mutex m_pool_mutex;
+	typedef detail::idle_connection<Database> idle_connection;
+
+	// Idle connections are spread over shards, so threads returning connections seldom contend for a lock.
+	// In each shard, the connection idle for the longest time is at the front.
+	struct shard
+	{
+		std::mutex mutex;
+		std::vector<idle_connection> databases;
+		std::atomic<size_t> count;
+
+		shard() : count(0) { }
+	};
+	// Lets threads which outlive the pool free their slots while the pool exists.
+	struct pool_link
+	{
+		std::mutex mutex;
+		database_pool* pool;
+
+		explicit pool_link(database_pool* p) : pool(p) { }
+	};
+	// is_alive runs on its own thread, so the check can be abandoned when it does not finish in time.
+	struct alive_check
+	{
+		std::mutex mutex;
+		std::condition_variable cv;
+		Database* db;
+		std::chrono::steady_clock::time_point deadline;
+		bool done;
+		bool alive;
+		bool abandoned;
+
+		alive_check(Database* connection, std::chrono::steady_clock::time_point deadline)
+			: db(connection), deadline(deadline), done(false), alive(false), abandoned(false) { }
+	};
+	// A thread waiting for a connection, it is woken when a connection is handed over or a slot is freed.
+	struct waiter
+	{
+		std::condition_variable cv;
+		Database* db;
+		bool signaled;
+
+		waiter() : db(NULL), signaled(false) { }
+	};
+
+	std::unique_ptr<shard[]> m_shards;
+	size_t m_shard_count;
+	std::atomic<size_t> m_min_size;
+	std::atomic<size_t> m_max_size;
+	std::atomic<size_t> m_size;
+	std::chrono::milliseconds m_validate_after;
+	std::chrono::milliseconds m_idle_timeout;
+	size_t m_check_concurrency;
+	std::chrono::milliseconds m_check_timeout;
+	std::mutex m_wait_mutex;
+	std::deque<waiter*> m_waiters;
+	std::atomic<size_t> m_waiting;
 	std::atomic<bool> m_trying_connection;
 	std::thread m_background_thread;
-	bool m_stop_thread;
+	std::thread m_maintenance_thread;
+	std::mutex m_maintenance_mutex;
+	std::condition_variable m_maintenance_cv;
+	std::atomic<bool> m_stop_thread;
+	detail::pool_statistics m_statistics;
+	std::shared_ptr<pool_link> m_link;
 
 	virtual Database* new_database() throw()=0;
-	void recovery(Database* db)
+
+	Database* open_database()
+	{
+		detail::pool_statistics::clock::time_point start=m_statistics.connecting();
+		Database* db=new_database();
+		m_statistics.connected(start, db!=NULL);
+		return db;
+	}
+
+	pointer wrap(Database* db)
+	{
+		if(db==NULL) return pointer();
+		return pointer(db, [this](Database* db) {
+			recovery(db);
+		});
+	}
+
+	Database* acquire()
 	{
-		if(db==NULL) return;
-		if(db->is_alive())
+		idle_connection connection;
+		while(popup(connection))
 		{
-			std::lock_guard<std::mutex> lock(m_pool_mutex);
-			m_databases.push_back(db);
+			if(std::chrono::steady_clock::now()-connection.since<m_validate_after)
+				return connection.db;
+			bool alive=connection.db->is_alive();
+			m_statistics.validated(alive);
+			if(alive)
+				return connection.db;
+			delete connection.db;
+			release_slot();
 		}
-		else
+		if(m_trying_connection==false && reserve_slot())
+			return create_database();
+		return NULL;
+	}
+
+	Database* wait(const std::chrono::steady_clock::time_point& deadline)
+	{
+		waiter w;
+		std::unique_lock<std::mutex> lock(m_wait_mutex);
+		m_waiters.push_back(&w);
+		++m_waiting;
+		for(;;)
 		{
-			delete db;
+			Database* db=NULL;
+			w.signaled=false;
+			if(m_waiters.front()==&w)
 			{
-				std::lock_guard<std::mutex> lock(m_pool_mutex);
-				clear();
+				// only the first waiter takes connections, a connection may be returned before it is queued
+				lock.unlock();
+				db=acquire();
+				lock.lock();
+			}
+			if(db==NULL && w.db==NULL)
+			{
+				if(!w.cv.wait_until(lock, deadline, [&w]() { return w.db!=NULL || w.signaled; }))
+				{
+					remove_waiter(&w);
+					return NULL;
+				}
+			}
+			if(w.db)
+			{
+				// the waiter has been dequeued by the thread which handed over the connection
+				if(db)
+				{
+					lock.unlock();
+					push(db);
+				}
+				return w.db;
+			}
+			if(db)
+			{
+				remove_waiter(&w);
+				return db;
 			}
-			try_connect();
 		}
 	}
 
-	Database* create_database()
+	void remove_waiter(waiter* w)
 	{
-		Database* db=new_database();
-		if(db) return db;
+		auto it=std::find(m_waiters.begin(), m_waiters.end(), w);
+		if(it!=m_waiters.end())
+		{
+			bool first=it==m_waiters.begin();
+			m_waiters.erase(it);
+			--m_waiting;
+			// the next waiter becomes the first one, it may take a connection now
+			if(first && !m_waiters.empty())
+			{
+				m_waiters.front()->signaled=true;
+				m_waiters.front()->cv.notify_one();
+			}
+		}
+	}
 
+	bool reserve_slot()
+	{
+		size_t size=m_size.load();
+		do
 		{
-			std::lock_guard<std::mutex> lock(m_pool_mutex);
-			clear();
+			if(size>=m_max_size) return false;
+		} while(!m_size.compare_exchange_weak(size, size+1));
+		return true;
+	}
+
+	// Frees a slot for a connection which is closed or can not be opened, a waiting thread can open a new one.
+	void release_slot()
+	{
+		--m_size;
+		signal_waiter();
+	}
+
+	// Wakes the first waiting thread, so it tries to take or open a connection.
+	void signal_waiter()
+	{
+		if(m_waiting>0)
+		{
+			std::lock_guard<std::mutex> lock(m_wait_mutex);
+			if(!m_waiters.empty())
+			{
+				waiter* w=m_waiters.front();
+				w->signaled=true;
+				w->cv.notify_one();
+			}
 		}
+	}
+
+	void recovery(Database* db)
+	{
+		if(db) push(db);
+	}
+
+	Database* create_database()
+	{
+		Database* db=open_database();
+		if(db) return db;
+
+		release_slot();
+		clear();
 		try_connect();
 		return NULL;
 	}
 
-	Database* popup()
+	size_t home_shard() const
+	{
+		return std::hash<std::thread::id>()(std::this_thread::get_id())%m_shard_count;
+	}
+
+	bool popup(idle_connection& connection)
 	{
-		Database* db=NULL;
-		std::lock_guard<std::mutex> lock(m_pool_mutex);
-		if(!m_databases.empty())
+		size_t home=home_shard();
+		for(size_t i=0; i!=m_shard_count; i++)
 		{
-			db=m_databases.back();
-			m_databases.pop_back();
+			shard& s=m_shards[(home+i)%m_shard_count];
+			if(s.count==0) continue;
+			std::lock_guard<std::mutex> lock(s.mutex);
+			if(!s.databases.empty())
+			{
+				connection=s.databases.back();
+				s.databases.pop_back();
+				s.count=s.databases.size();
+				return true;
+			}
 		}
-		return db;
+		return false;
+	}
+
+	// Returns a connection to the pool, or hands it over to the first waiting thread.
+	void push(Database* db)
+	{
+		if(m_waiting>0)
+		{
+			std::lock_guard<std::mutex> lock(m_wait_mutex);
+			if(!m_waiters.empty())
+			{
+				waiter* w=m_waiters.front();
+				m_waiters.pop_front();
+				--m_waiting;
+				w->db=db;
+				w->cv.notify_one();
+				return;
+			}
+		}
+		{
+			shard& s=m_shards[home_shard()];
+			std::lock_guard<std::mutex> lock(s.mutex);
+			s.databases.push_back(idle_connection(db));
+			s.count=s.databases.size();
+		}
+		// a thread may start waiting after m_waiting is read, and miss the connection in its shard
+		signal_waiter();
 	}
 
 	void try_connect()
 	{
-		if(m_trying_connection)
+		if(m_trying_connection.exchange(true))
 			return;
 
-		m_trying_connection=true;
-		
 		try
 		{
+			if(m_background_thread.joinable())
+				m_background_thread.detach();
 			m_background_thread=std::thread(&database_pool<Database>::background_connect, this);
 		}
 		catch (std::system_error&)
@@ -150,29 +638,162 @@ private:
 
 	void background_connect()
 	{
-		Database* db=NULL;
 		int interval=1;
-		while(db==NULL && m_stop_thread==false)
+		while(m_stop_thread==false && m_size<std::max<size_t>(m_min_size, 1) && reserve_slot())
 		{
-			db=create_database();
-			if(db==NULL)
+			Database* db=open_database();
+			if(db)
+			{
+				push(db);
+				interval=1;
+			}
+			else
 			{
+				release_slot();
 				std::this_thread::sleep_for(std::chrono::seconds(interval));
 				if(interval<60) interval<<=1;
 			}
 		}
-		if(db)
+		m_trying_connection=false;
+	}
+
+	// Takes out the connection idle for the longest time, if it has been idle since before.
+	Database* checkout(std::chrono::steady_clock::time_point before)
+	{
+		for(size_t i=0; i!=m_shard_count; i++)
 		{
-			recovery(db);
+			shard& s=m_shards[i];
+			if(s.count==0) continue;
+			std::lock_guard<std::mutex> lock(s.mutex);
+			if(!s.databases.empty() && s.databases.front().since<before)
+			{
+				Database* db=s.databases.front().db;
+				s.databases.erase(s.databases.begin());
+				s.count=s.databases.size();
+				return db;
+			}
 		}
-		m_background_thread.detach();
-		m_trying_connection=false;
+		return NULL;
+	}
+
+	std::shared_ptr<alive_check> start_check(Database* db)
+	{
+		std::shared_ptr<alive_check> check=std::make_shared<alive_check>(db, std::chrono::steady_clock::now()+m_check_timeout);
+		try
+		{
+			std::shared_ptr<pool_link> link=m_link;
+			std::thread([check, link]() {
+				bool alive=check->db->is_alive();
+				{
+					std::lock_guard<std::mutex> lock(check->mutex);
+					if(!check->abandoned)
+					{
+						check->alive=alive;
+						check->done=true;
+						check->cv.notify_one();
+						return;
+					}
+				}
+				// the slot of an abandoned connection is kept until it is closed
+				delete check->db;
+				std::lock_guard<std::mutex> lock(link->mutex);
+				if(link->pool) link->pool->release_slot();
+			}).detach();
+		}
+		catch (std::system_error&)
+		{
+			check->alive=db->is_alive();
+			check->done=true;
+		}
+		return check;
+	}
+
+	// Waits for the result of a check, returns the connection to the pool if it is alive.
+	bool finish_check(alive_check& check)
+	{
+		std::unique_lock<std::mutex> lock(check.mutex);
+		if(!check.cv.wait_until(lock, check.deadline, [&check]() { return check.done; }))
+		{
+			// the checking thread closes the connection and frees its slot when is_alive returns
+			check.abandoned=true;
+			lock.unlock();
+			m_statistics.validated(false);
+			return false;
+		}
+		lock.unlock();
+		m_statistics.validated(check.alive);
+		if(check.alive)
+		{
+			push(check.db);
+		}
+		else
+		{
+			delete check.db;
+			release_slot();
+		}
+		return check.alive;
+	}
+
+	void maintain()
+	{
+		std::unique_lock<std::mutex> lock(m_maintenance_mutex);
+		while(m_stop_thread==false)
+		{
+			std::chrono::milliseconds interval=std::max(m_idle_timeout/2, std::chrono::milliseconds(100));
+			m_maintenance_cv.wait_for(lock, interval);
+			if(m_stop_thread || m_idle_timeout.count()==0) continue;
+			std::chrono::milliseconds timeout=m_idle_timeout;
+			lock.unlock();
+			evict(timeout);
+			lock.lock();
+		}
+	}
+
+	// Closes connections idle for longer than timeout, but keeps min_size connections.
+	void evict(std::chrono::milliseconds timeout)
+	{
+		std::vector<Database*> expired;
+		std::chrono::steady_clock::time_point now=std::chrono::steady_clock::now();
+		for(size_t i=0; i!=m_shard_count; i++)
+		{
+			shard& s=m_shards[i];
+			if(s.count==0) continue;
+			std::lock_guard<std::mutex> lock(s.mutex);
+			auto it=s.databases.begin();
+			while(it!=s.databases.end() && now-it->since>timeout && shrink())
+			{
+				expired.push_back(it->db);
+				++it;
+			}
+			s.databases.erase(s.databases.begin(), it);
+			s.count=s.databases.size();
+		}
+		std::for_each(expired.begin(), expired.end(), std::default_delete<Database>());
+		m_statistics.evicted(expired.size());
+	}
+
+	bool shrink()
+	{
+		size_t size=m_size.load();
+		do
+		{
+			if(size<=m_min_size) return false;
+		} while(!m_size.compare_exchange_weak(size, size-1));
+		return true;
 	}
 
 	void clear()
 	{
-		std::for_each(m_databases.begin(), m_databases.end(), std::default_delete<Database>());
-		m_databases.clear();
+		for(size_t i=0; i!=m_shard_count; i++)
+		{
+			shard& s=m_shards[i];
+			std::lock_guard<std::mutex> lock(s.mutex);
+			for(const idle_connection& connection : s.databases)
+				delete connection.db;
+			m_size-=s.databases.size();
+			s.databases.clear();
+			s.count=0;
+		}
 	}
 };
 
@@ -182,149 +803,469 @@ class async_pool
 public:
 	typedef Connection value_type;
 	typedef std::shared_ptr<Connection> pointer;
+	typedef typename Connection::exception_type exception_type;
 
 	async_pool(EventLoop& ev)
-		: m_ev(ev), m_trying_connecting(false)
+		: m_ev(ev), m_trying_connecting(false), m_min_size(0), m_max_size(SIZE_MAX), m_max_waiters(SIZE_MAX), m_size(0),
+		m_validate_after(std::chrono::seconds(30)), m_idle_timeout(0), m_evicting(false), m_reconnect_interval(1),
+		m_alive(std::make_shared<bool>(true))
 	{
 	}
 
+	/*
+		Handlers still queued are called with the error returned by T::closed_error().
+		Timers of the pool may fire later, they do nothing once the pool is destroyed.
+	 */
 	virtual ~async_pool()
 	{
+		m_alive.reset();
+		std::deque<std::shared_ptr<waiter>> waiters;
+		{
+			std::lock_guard<std::recursive_mutex> lock(m_pool_mutex);
+			waiters.swap(m_waiters);
+		}
+		for (const std::shared_ptr<waiter>& queued : waiters)
+			queued->handler(T::closed_error(), nullptr);
 		clear();
 	}
 
+	// The pool keeps min_size connections open when it evicts idle connections.
+	void set_min_size(size_t min_size) { m_min_size=min_size; }
+	size_t min_size() const { return m_min_size; }
+	// The pool opens at most max_size connections, the default is unlimited.
+	void set_max_size(size_t max_size) { m_max_size=std::max<size_t>(max_size, 1); }
+	size_t max_size() const { return m_max_size; }
+	// Requests for connections queued beyond this count fail at once, the default is unlimited.
+	void set_max_waiters(size_t max_waiters) { m_max_waiters=max_waiters; }
+	size_t max_waiters() const { return m_max_waiters; }
+	// Count of open connections, including connections in use.
+	size_t size() const { return m_size; }
+
+	// A connection idle for at least this time is checked by is_alive before it is handed out, the default is 30 seconds.
+	template<typename Rep, typename Period>
+	void set_validate_after(const std::chrono::duration<Rep, Period>& idle_time)
+	{
+		m_validate_after=std::chrono::duration_cast<std::chrono::milliseconds>(idle_time);
+	}
+
 	/*
+		Connections idle for longer than timeout are closed by a timer of the event loop, until min_size connections remain.
+		A zero timeout, which is the default, keeps idle connections open.
+	 */
+	template<typename Rep, typename Period>
+	void set_idle_timeout(const std::chrono::duration<Rep, Period>& timeout)
+	{
+		m_idle_timeout=std::chrono::duration_cast<std::chrono::milliseconds>(timeout);
+		if(m_idle_timeout.count()>0 && !m_evicting.exchange(true))
+			schedule_eviction();
+	}
+
+	/*
+		Opens connections up to min_size at the same time.
 		Handler defines as:
-		void handler(const pointer& ptr);
+		void handler(const exception_type& e);
+		e is the last error if any connection can not be opened.
 	*/
 	template<typename Handler>
-	void get(Handler&& handler, EventLoop* ev=nullptr)
+	void warm_up(Handler&& handler)
 	{
-		Connection* db = popup();
-		if(ev==nullptr) ev=&m_ev;
-		
-		if(db)
+		struct warm_up_state
+		{
+			std::mutex mutex;
+			size_t pending;
+			exception_type error;
+			typename std::decay<Handler>::type handler;
+
+			warm_up_state(size_t count, Handler&& handler)
+				: pending(count), handler(std::forward<Handler>(handler)) { }
+		};
+
+		size_t count=0;
+		while(m_size<m_min_size && reserve_slot())
+			++count;
+		if(count==0)
 		{
-			db->bind(*ev);
-			handler(typename Connection::exception_type(), wrap(db));
+			handler(exception_type());
+			return;
 		}
-		else if (m_trying_connecting == false)
+		auto state=std::make_shared<warm_up_state>(count, std::forward<Handler>(handler));
+		for(size_t i=0; i!=count; i++)
 		{
-			create_connection(ev, [this, handler](const typename Connection::exception_type& e,  Connection* db) {
-				handler(e, wrap(db));
+			create_connection(&m_ev, [this, state](const exception_type& e, Connection* db) {
+				if(db)
+					release(db);
+				else
+					connect_failed();
+				std::unique_lock<std::mutex> lock(state->mutex);
+				if(e) state->error=e;
+				if(--state->pending==0)
+				{
+					lock.unlock();
+					state->handler(state->error);
+				}
 			});
 		}
-		else
+	}
+
+	/*
+		Handler defines as:
+		void handler(const exception_type& e, const pointer& ptr);
+		If all connections are in use, the handler is queued until a connection is returned or opened.
+		Queued handlers are served in FIFO order, ptr is null if the queue is full.
+	*/
+	template<typename Handler>
+	void get(Handler&& handler, EventLoop* ev=nullptr)
+	{
+		request(std::forward<Handler>(handler), ev, std::chrono::milliseconds::max());
+	}
+
+	// Like get above, but ptr is null if no connection is available within timeout.
+	template<typename Handler, typename Rep, typename Period>
+	void get(Handler&& handler, const std::chrono::duration<Rep, Period>& timeout, EventLoop* ev=nullptr)
+	{
+		request(std::forward<Handler>(handler), ev, std::chrono::duration_cast<std::chrono::milliseconds>(timeout));
+	}
+
+	// It can be called by a monitoring thread, the pool is locked only to count idle connections and waiters.
+	pool_metrics metrics()
+	{
+		size_t idle, waiting;
 		{
-			handler(typename Connection::exception_type(), nullptr);
+			std::lock_guard<std::recursive_mutex> lock(m_pool_mutex);
+			idle = m_connections.size();
+			waiting = m_waiters.size();
 		}
+		pool_metrics result;
+		m_statistics.snapshot(result, m_size, idle, waiting);
+		return result;
 	}
 
+	/*
+		Checks the connections idle when it is called, and closes the dead ones.
+		A connection is taken out of the pool while it is checked, so it can not be handed out during the check.
+	 */
 	void test_alive()
 	{
-		if (m_connections.empty())
-			return;
-		std::unique_lock<std::mutex> lock(m_pool_mutex);
-		auto it = m_connections.begin();
-		while (it != m_connections.end())
+		std::vector<idle_connection> connections;
+		{
+			std::lock_guard<std::recursive_mutex> lock(m_pool_mutex);
+			connections.swap(m_connections);
+		}
+		for (const idle_connection& connection : connections)
 		{
-			Connection* db = *it;
-			db->is_alive([this, db](const typename Connection::exception_type& e) {
+			Connection* db = connection.db;
+			db->bind(m_ev);
+			db->is_alive([this, db](const exception_type& e) {
+				m_statistics.validated(!e);
 				if (e)
 				{
-					std::unique_lock<std::mutex> lock(m_pool_mutex);
-					auto it = std::find(m_connections.begin(), m_connections.end(), db);
 					delete db;
-					m_connections.erase(it);
-					if (m_connections.empty())
-						try_connect();
+					if (--m_size == 0)
+						start_reconnect();
+					else
+						serve_waiter();
+				}
+				else
+				{
+					release(db);
 				}
 			});
-			++it;
 		}
 	}
 
 private:
+	typedef detail::idle_connection<Connection> idle_connection;
+	typedef std::function<void(const exception_type&, Connection*)> acquire_handler;
+
+	struct waiter
+	{
+		acquire_handler handler;
+		EventLoop* ev;
+
+		waiter(acquire_handler&& handler, EventLoop* ev) : handler(std::move(handler)), ev(ev) { }
+	};
+
 	EventLoop& m_ev;
-	std::vector<Connection*> m_connections;
+	// The connection idle for the longest time is at the front.
+	std::vector<idle_connection> m_connections;
+	std::deque<std::shared_ptr<waiter>> m_waiters;
 	std::recursive_mutex m_pool_mutex;
 	std::atomic<bool> m_trying_connecting;
+	std::atomic<size_t> m_min_size;
+	std::atomic<size_t> m_max_size;
+	std::atomic<size_t> m_max_waiters;
+	std::atomic<size_t> m_size;
+	std::chrono::milliseconds m_validate_after;
+	std::chrono::milliseconds m_idle_timeout;
+	std::atomic<bool> m_evicting;
+	std::chrono::seconds m_reconnect_interval;
+	detail::pool_statistics m_statistics;
+	// Timers hold a weak reference to it, it expires when the pool is destroyed.
+	std::shared_ptr<bool> m_alive;
 
-	void recovery(Connection* db)
+	static timeval to_timeval(std::chrono::milliseconds interval)
 	{
-		if (db == NULL) return;
-		db->is_alive([this, db](const typename Connection::exception_type& e) {
+		timeval tv = { static_cast<long>(interval.count() / 1000), static_cast<long>(interval.count() % 1000 * 1000) };
+		return tv;
+	}
+
+	template<typename Handler>
+	void request(Handler&& handler, EventLoop* ev, std::chrono::milliseconds timeout)
+	{
+		detail::pool_statistics::clock::time_point start = detail::pool_statistics::clock::now();
+		typename std::decay<Handler>::type result_handler(std::forward<Handler>(handler));
+		acquire([this, start, result_handler](const exception_type& e, Connection* db) mutable {
+			m_statistics.acquired(start, db != nullptr);
+			result_handler(e, wrap(db));
+		}, ev ? ev : &m_ev, timeout);
+	}
+
+	void acquire(acquire_handler&& handler, EventLoop* ev, std::chrono::milliseconds timeout)
+	{
+		idle_connection connection;
+		bool create = false;
+		std::shared_ptr<waiter> queued;
+		{
+			std::lock_guard<std::recursive_mutex> lock(m_pool_mutex);
+			if (!m_connections.empty())
+			{
+				connection = m_connections.back();
+				m_connections.pop_back();
+			}
+			else if (m_trying_connecting == false && reserve_slot())
+			{
+				create = true;
+			}
+			else if (m_waiters.size() < m_max_waiters)
+			{
+				queued = std::make_shared<waiter>(std::move(handler), ev);
+				m_waiters.push_back(queued);
+			}
+		}
+
+		if (connection.db)
+		{
+			hand_out(connection, std::move(handler), ev, timeout);
+		}
+		else if (create)
+		{
+			create_connection(ev, [this, handler](const exception_type& e, Connection* db) {
+				if (!db) connect_failed();
+				handler(e, db);
+			});
+		}
+		else if (queued)
+		{
+			if (timeout != std::chrono::milliseconds::max())
+			{
+				std::weak_ptr<bool> alive = m_alive;
+				ev->set_timeout(to_timeval(timeout), [this, alive, queued]() {
+					if (!alive.expired())
+						expire(queued);
+				});
+			}
+		}
+		else
+		{
+			handler(exception_type(), nullptr);
+		}
+	}
+
+	void hand_out(const idle_connection& connection, acquire_handler&& handler, EventLoop* ev, std::chrono::milliseconds timeout)
+	{
+		Connection* db = connection.db;
+		db->bind(*ev);
+		if (std::chrono::steady_clock::now() - connection.since < m_validate_after)
+		{
+			handler(exception_type(), db);
+			return;
+		}
+		db->is_alive([this, db, handler, ev, timeout](const exception_type& e) mutable {
+			m_statistics.validated(!e);
 			if (e)
 			{
-				{
-					std::lock_guard<std::recursive_mutex> lock(m_pool_mutex);
-					clear();
-				}
-				try_connect();
+				delete db;
+				--m_size;
+				acquire(std::move(handler), ev, timeout);
 			}
 			else
 			{
-				if(!db->unbind())
-					throw std::runtime_error("destroy a busysing connection.");
-				std::lock_guard<std::recursive_mutex> lock(m_pool_mutex);
-				m_connections.push_back(db);
+				handler(e, db);
 			}
 		});
 	}
 
+	// The handler of a waiter is called once, by the one who removes it from the queue.
+	void expire(const std::shared_ptr<waiter>& queued)
+	{
+		{
+			std::lock_guard<std::recursive_mutex> lock(m_pool_mutex);
+			auto it = std::find(m_waiters.begin(), m_waiters.end(), queued);
+			if (it == m_waiters.end())
+				return;
+			m_waiters.erase(it);
+		}
+		queued->handler(exception_type(), nullptr);
+	}
+
+	// Hands over an available connection to the first waiter, or keeps it idle.
+	void release(Connection* db)
+	{
+		std::shared_ptr<waiter> queued;
+		{
+			std::lock_guard<std::recursive_mutex> lock(m_pool_mutex);
+			if (m_waiters.empty())
+			{
+				m_connections.push_back(idle_connection(db));
+				return;
+			}
+			queued = m_waiters.front();
+			m_waiters.pop_front();
+		}
+		db->bind(*queued->ev);
+		queued->handler(exception_type(), db);
+	}
+
+	// Opens a connection for the first waiter after a connection is closed.
+	void serve_waiter()
+	{
+		std::shared_ptr<waiter> queued;
+		{
+			std::lock_guard<std::recursive_mutex> lock(m_pool_mutex);
+			if (m_waiters.empty() || m_trying_connecting || !reserve_slot())
+				return;
+			queued = m_waiters.front();
+			m_waiters.pop_front();
+		}
+		create_connection(queued->ev, [this, queued](const exception_type& e, Connection* db) {
+			if (!db) connect_failed();
+			queued->handler(e, db);
+		});
+	}
+
+	void recovery(Connection* db)
+	{
+		if (db == NULL) return;
+		if(!db->unbind())
+			throw std::runtime_error("destroy a busysing connection.");
+		release(db);
+	}
+
+	bool reserve_slot()
+	{
+		size_t size = m_size.load();
+		do
+		{
+			if (size >= m_max_size) return false;
+		} while (!m_size.compare_exchange_weak(size, size + 1));
+		return true;
+	}
+
+	// The slot of a connection is reserved before it is opened.
 	template<typename Handler>
 	void create_connection(EventLoop* ev, Handler&& handler)
 	{
 		T* pThis = static_cast<T*>(this);
-		pThis->new_connection(*ev, [this, handler](const typename Connection::exception_type& e, Connection* db) {
+		detail::pool_statistics::clock::time_point start = m_statistics.connecting();
+		pThis->new_connection(*ev, [this, handler, start](const exception_type& e, Connection* db) {
+			m_statistics.connected(start, db != nullptr);
 			handler(e, db);
-			if (!db)
-			{
-				std::lock_guard<std::recursive_mutex> lock(m_pool_mutex);
-				clear();
-
-				timeval tv = { 1,  0};
-				m_ev.set_timeout(tv, [this]() {
-					try_connect();
-				});
-			}
 		});
 	}
 
-	Connection* popup()
+	// The server seems unreachable, idle connections are closed and the pool reconnects in background.
+	void connect_failed()
 	{
-		Connection* db = nullptr;
-		std::lock_guard<std::recursive_mutex> lock(m_pool_mutex);
-		if (!m_connections.empty())
+		--m_size;
 		{
-			db = m_connections.back();
-			m_connections.pop_back();
+			std::lock_guard<std::recursive_mutex> lock(m_pool_mutex);
+			clear();
 		}
-		return db;
+		start_reconnect();
 	}
 
-	void try_connect()
+	void start_reconnect()
 	{
-		if (m_trying_connecting)
+		if (m_trying_connecting.exchange(true))
 			return;
+		schedule_reconnect();
+	}
+
+	// Waiters are kept while reconnecting, the interval doubles after each failure up to a minute.
+	void schedule_reconnect()
+	{
+		std::chrono::seconds interval = m_reconnect_interval;
+		m_reconnect_interval = std::min(interval * 2, std::chrono::seconds(60));
+		std::weak_ptr<bool> alive = m_alive;
+		m_ev.set_timeout(to_timeval(interval), [this, alive]() {
+			if (!alive.expired())
+				try_connect();
+		});
+	}
 
-		m_trying_connecting = true;
-		create_connection(&m_ev, [this](const typename Connection::exception_type& e, Connection* db) {
+	void try_connect()
+	{
+		if (!reserve_slot())
+		{
+			m_trying_connecting = false;
+			return;
+		}
+		create_connection(&m_ev, [this](const exception_type& e, Connection* db) {
 			if (db)
 			{
-				std::lock_guard<std::recursive_mutex> lock(m_pool_mutex);
-				m_connections.push_back(db);
+				m_reconnect_interval = std::chrono::seconds(1);
+				m_trying_connecting = false;
+				release(db);
+				serve_waiter();
 			}
 			else
 			{
-				m_trying_connecting = false;
+				--m_size;
+				schedule_reconnect();
+			}
+		});
+	}
+
+	void schedule_eviction()
+	{
+		std::chrono::milliseconds interval = std::max(m_idle_timeout / 2, std::chrono::milliseconds(100));
+		std::weak_ptr<bool> alive = m_alive;
+		m_ev.set_timeout(to_timeval(interval), [this, alive]() {
+			if (alive.expired())
+				return;
+			if (m_idle_timeout.count() > 0)
+			{
+				evict();
+				schedule_eviction();
+			}
+			else
+			{
+				m_evicting = false;
 			}
 		});
 	}
 
+	// Closes connections idle for longer than the idle timeout, but keeps min_size connections.
+	void evict()
+	{
+		std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+		std::lock_guard<std::recursive_mutex> lock(m_pool_mutex);
+		auto it = m_connections.begin();
+		while (it != m_connections.end() && now - it->since > m_idle_timeout && m_size > m_min_size)
+		{
+			delete it->db;
+			--m_size;
+			++it;
+		}
+		m_statistics.evicted(it - m_connections.begin());
+		m_connections.erase(m_connections.begin(), it);
+	}
+
 	void clear()
 	{
-		std::for_each(m_connections.begin(), m_connections.end(), std::default_delete<Connection>());
+		for (const idle_connection& connection : m_connections)
+			delete connection.db;
+		m_size -= m_connections.size();
 		m_connections.clear();
 	}
 
@@ -32,6 +32,11 @@ namespace qtl
 namespace mysql
 {
 
+// Initial size of the buffer bound to a string field, it grows when a longer value is fetched.
+const unsigned long string_buffer_size=1024;
+// Strings are not limited by default.
+const unsigned long unlimited_string=(unsigned long)-1;
+
 struct init
 {
 	init(int argc=-1, char **argv=nullptr, char **groups=nullptr) 
@@ -350,15 +355,32 @@ struct time : public MYSQL_TIME
 	}
 };
 
+/*
+	How the rows of a query are received:
+	unbuffered reads rows from the connection while they are fetched, it is the default.
+	buffered stores all rows in the client by mysql_stmt_store_result after executing, so the count of rows is known.
+	cursor opens a read-only cursor on the server, which sends prefetch rows in each round trip,
+		so the memory of the client is bounded however large the result is.
+ */
+enum class fetch_mode
+{
+	unbuffered,
+	buffered,
+	cursor
+};
+
 class base_statement
 {
 protected:
-	base_statement() : m_stmt(nullptr), m_result(nullptr) {}
+	base_statement() : m_stmt(nullptr), m_result(nullptr), m_string_limit(unlimited_string),
+		m_fetch_mode(mysql::fetch_mode::unbuffered), m_prefetch_rows(1) {}
 	base_statement(const base_statement&) = delete;
 	explicit base_statement(basic_database& db);
 	base_statement(base_statement&& src)
 		: m_stmt(src.m_stmt), m_result(src.m_result),
-		m_binders(std::move(src.m_binders)), m_binderAddins(std::move(src.m_binderAddins))
+		m_binders(std::move(src.m_binders)), m_binderAddins(std::move(src.m_binderAddins)),
+		m_before_fetch(std::move(src.m_before_fetch)), m_after_fetch(std::move(src.m_after_fetch)), m_string_limit(src.m_string_limit),
+		m_fetch_mode(src.m_fetch_mode), m_prefetch_rows(src.m_prefetch_rows)
 	{
 		src.m_stmt=nullptr;
 		src.m_result=nullptr;
@@ -374,6 +396,11 @@ protected:
 			src.m_result=nullptr;
 			m_binders=std::move(src.m_binders);
 			m_binderAddins=std::move(src.m_binderAddins);
+			m_before_fetch=std::move(src.m_before_fetch);
+			m_after_fetch=std::move(src.m_after_fetch);
+			m_string_limit=src.m_string_limit;
+			m_fetch_mode=src.m_fetch_mode;
+			m_prefetch_rows=src.m_prefetch_rows;
 		}
 		return *this;
 	}
@@ -391,6 +418,22 @@ public:
 			return nullptr;
 	}
 
+	// Maximum length of string fields bound later, the statement takes it from the database when opened.
+	void set_string_limit(unsigned long limit) { m_string_limit = limit; }
+	unsigned long string_limit() const { return m_string_limit; }
+
+	// Sets how the rows of following executions are received, prefetch_rows is used by fetch_mode::cursor.
+	void set_fetch_mode(mysql::fetch_mode mode, unsigned long prefetch_rows = 1)
+	{
+		m_fetch_mode = mode;
+		m_prefetch_rows = prefetch_rows > 0 ? prefetch_rows : 1;
+		apply_fetch_mode();
+	}
+	mysql::fetch_mode fetch_mode() const { return m_fetch_mode; }
+
+	// Moves to a row of the current result in fetch_mode::buffered, the next fetch reads it.
+	void seek(uint64_t row) { mysql_stmt_data_seek(m_stmt, row); }
+
 	unsigned long length(unsigned int index) const
 	{
 		return m_binderAddins[index].m_length;
@@ -439,6 +482,9 @@ public:
 
 	MYSQL_RES* result() { return m_result; }
 
+	// Returns the count of rows if the result set has been stored, otherwise 0.
+	size_t get_row_count() { return static_cast<size_t>(mysql_stmt_num_rows(m_stmt)); }
+
 	void bind_param(size_t index, const char* param, size_t length)
 	{
 		bind(m_binders[index], param, length);
@@ -452,31 +498,13 @@ public:
 	void bind_param(size_t index, std::istream& param)
 	{
 		m_binders[index].bind(nullptr, 0, MYSQL_TYPE_LONG_BLOB);
-		m_binderAddins[index].m_after_fetch = [this, index, &param](const binder&) {
-			std::array<char, blob_buffer_size> buffer;
-			unsigned long readed = 0;
-			while (!param.eof() && !param.fail())
-			{
-				param.read(buffer.data(), buffer.size());
-				readed = (unsigned long)param.gcount();
-				if (readed > 0)
-				{
-					if (mysql_stmt_send_long_data(m_stmt, index, buffer.data(), readed) != 0)
-						throw_exception();
-				}
-			}
-		};
+		add_step(m_after_fetch, index, &send_stream, &param);
 	}
 
 	void bind_param(size_t index, const blob_writer& param)
 	{
 		m_binders[index].bind(nullptr, 0, MYSQL_TYPE_LONG_BLOB);
-		m_binderAddins[index].m_after_fetch = [this, index, &param](const binder& b) {
-			blobbuf buf;
-			buf.open(m_stmt, index, b, std::ios::out);
-			std::ostream s(&buf);
-			param(s);
-		};
+		add_step(m_after_fetch, index, &write_blob, const_cast<blob_writer*>(&param));
 	}
 
 	template<class Param>
@@ -491,23 +519,15 @@ public:
 		if (m_result)
 		{
 			bind(m_binders[index], std::forward<Type>(value));
-			m_binderAddins[index].m_after_fetch = 
-				if_null<typename std::remove_reference<Type>::type>(value);
+			if (is_nullable(index))
+				add_step(m_after_fetch, index, &reset_if_null<typename std::remove_reference<Type>::type>, &value);
 		}
 	}
 
 	void bind_field(size_t index, char* value, size_t length)
 	{
 		m_binders[index].bind(value, length - 1, MYSQL_TYPE_VAR_STRING);
-		m_binderAddins[index].m_after_fetch = [](const binder& bind) {
-			if (*bind.is_null)
-				memset(bind.buffer, 0, bind.buffer_length + 1);
-			else
-			{
-				char* text = reinterpret_cast<char*>(bind.buffer);
-				text[*bind.length] = '\0';
-			}
-		};
+		add_step(m_after_fetch, index, &terminate_text, value);
 	}
 
 	template<size_t N>
@@ -523,24 +543,12 @@ public:
 		{
 			MYSQL_FIELD* field = mysql_fetch_field_direct(m_result, (unsigned int)index);
 			if (field == nullptr) throw_exception();
+			unsigned long size = std::min(field->length, std::min(string_buffer_size, m_string_limit));
 			value.clear();
-			typename bind_string_helper<T>::char_type* data = value.alloc(field->length);
-			m_binderAddins[index].m_before_fetch = [this, value](binder& b) mutable {
-				if (value.size() < b.buffer_length)
-				{
-					value.alloc(b.buffer_length);
-					if (b.buffer != value.data())
-					{
-						b.buffer = const_cast<char*>(value.data());
-						mysql_stmt_bind_result(m_stmt, &m_binders.front());
-					}
-				}
-			};
-			m_binderAddins[index].m_after_fetch = [value](const binder& b) mutable {
-				if (*b.is_null) value.clear();
-				else value.truncate(*b.length);
-			};
-			m_binders[index].bind((void*)data, field->length, field->type);
+			typename bind_string_helper<T>::char_type* data = value.alloc(size);
+			add_step(m_before_fetch, index, &grow_string<T>, &value.value());
+			add_step(m_after_fetch, index, &truncate_string<T>, &value.value());
+			m_binders[index].bind((void*)data, size, field->type);
 		}
 	}
 
@@ -551,22 +559,7 @@ public:
 			MYSQL_FIELD* field = mysql_fetch_field_direct(m_result, (unsigned int)index);
 			assert(IS_LONGDATA(field->type));
 			m_binders[index].bind(nullptr, 0, field->type);
-			m_binderAddins[index].m_after_fetch = [this, index, &value](const binder& b) {
-				unsigned long readed = 0;
-				std::array<char, blob_buffer_size> buffer;
-				binder& bb = const_cast<binder&>(b);
-				if (*b.is_null) return;
-				bb.buffer = const_cast<char*>(buffer.data());
-				bb.buffer_length = buffer.size();
-				while (readed <= *b.length)
-				{
-					int ret = mysql_stmt_fetch_column(m_stmt, &bb, index, readed);
-					if (ret != 0)
-						throw_exception();
-					value.write(buffer.data(), std::min(b.buffer_length, *b.length - b.offset));
-					readed += bb.buffer_length;
-				}
-			};
+			add_step(m_after_fetch, index, &read_stream, &value);
 		}
 	}
 
@@ -577,10 +570,7 @@ public:
 			MYSQL_FIELD* field = mysql_fetch_field_direct(m_result, (unsigned int)index);
 			assert(IS_LONGDATA(field->type));
 			m_binders[index].bind(nullptr, 0, field->type);
-			m_binderAddins[index].m_after_fetch = [this, index, &value](const binder& b) {
-				if (*b.is_null) return;
-				value.open(m_stmt, index, b, std::ios::in);
-			};
+			add_step(m_after_fetch, index, &open_blob, &value);
 		}
 	}
 
@@ -590,14 +580,7 @@ public:
 		if (m_result)
 		{
 			qtl::bind_field(*this, index, value.data);
-			binder_addin& addin = m_binderAddins[index];
-			auto fetch_fun = addin.m_after_fetch;
-			addin.m_after_fetch = [&addin, fetch_fun, &value](const binder& b) {
-				value.is_null = *b.is_null != 0;
-				value.length = *b.length;
-				value.is_truncated = addin.is_truncated;
-				if (fetch_fun) fetch_fun(b);
-			};
+			add_step(m_after_fetch, index, &set_indicator<Type>, &value);
 		}
 	}
 
@@ -609,12 +592,8 @@ public:
 		if (m_result)
 		{
 			qtl::bind_field(*this, index, *value);
-			binder_addin& addin = m_binderAddins[index];
-			auto fetch_fun = addin.m_after_fetch;
-			addin.m_after_fetch = [&addin, fetch_fun, &value](const binder& b) {
-				if (fetch_fun) fetch_fun(b);
-				if (*b.is_null) value.reset();
-			};
+			if (is_nullable(index))
+				add_step(m_after_fetch, index, &reset_if_null<std::optional<T>>, &value);
 		}
 	}
 
@@ -690,12 +669,8 @@ public:
 			default:
 				throw mysql::error(CR_UNSUPPORTED_PARAM_TYPE, "Unsupported field type");
 			}
-			binder_addin& addin = m_binderAddins[index];
-			auto fetch_fun = addin.m_after_fetch;
-			addin.m_after_fetch = [&addin, fetch_fun, &value](const binder& b) {
-				if (fetch_fun) fetch_fun(b);
-				if (*b.is_null) value.reset();
-			};
+			if (is_nullable(index))
+				add_step(m_after_fetch, index, &reset_if_null<std::any>, &value);
 		}
 	}
 
@@ -725,16 +700,64 @@ protected:
 		unsigned long m_length;
 		my_bool m_isNull;
 		my_bool m_error;
-		bool is_truncated;
-		std::function<void(binder&)> m_before_fetch;
-		std::function<void(const binder&)> m_after_fetch;
 	};
 	std::vector<binder_addin> m_binderAddins;
 
+	/*
+		Work done around mysql_stmt_fetch for a column which needs it, such as a nullable or string field.
+		Steps are plain functions of the bound value, so columns which need nothing are not visited for each row.
+		After binding parameters, m_after_fetch sends the parameters which are streamed.
+	 */
+	typedef void (*step_function)(base_statement& stmt, size_t index, void* value);
+	struct fetch_step
+	{
+		size_t index;
+		step_function function;
+		void* value;
+	};
+	std::vector<fetch_step> m_before_fetch;
+	std::vector<fetch_step> m_after_fetch;
+	unsigned long m_string_limit;
+	mysql::fetch_mode m_fetch_mode;
+	unsigned long m_prefetch_rows;
+
+	void apply_fetch_mode()
+	{
+		if (m_stmt == nullptr) return;
+		unsigned long type = m_fetch_mode == mysql::fetch_mode::cursor ? CURSOR_TYPE_READ_ONLY : CURSOR_TYPE_NO_CURSOR;
+		if (mysql_stmt_attr_set(m_stmt, STMT_ATTR_CURSOR_TYPE, &type) ||
+			mysql_stmt_attr_set(m_stmt, STMT_ATTR_PREFETCH_ROWS, &m_prefetch_rows))
+			throw_exception();
+	}
+	bool need_store() const
+	{
+		return m_fetch_mode == mysql::fetch_mode::buffered && mysql_stmt_field_count(m_stmt) > 0;
+	}
+
 	void resize_binders(size_t n)
 	{
 		m_binders.resize(n);
 		m_binderAddins.resize(n);
+		clear_steps();
+	}
+	void clear_steps()
+	{
+		m_before_fetch.clear();
+		m_after_fetch.clear();
+	}
+	void add_step(std::vector<fetch_step>& steps, size_t index, step_function function, void* value)
+	{
+		fetch_step step = { index, function, value };
+		steps.push_back(step);
+	}
+	void run_steps(const std::vector<fetch_step>& steps)
+	{
+		for (const fetch_step& step : steps)
+			step.function(*this, step.index, step.value);
+	}
+	bool is_nullable(size_t index) const
+	{
+		return (m_result->fields[index].flags & NOT_NULL_FLAG) == 0;
 	}
 	void set_binders()
 	{
@@ -752,28 +775,151 @@ protected:
 	void throw_exception() const { throw mysql::error(*this); }
 
 	template<typename Value>
-	struct if_null
+	static void reset_if_null(base_statement& stmt, size_t index, void* value)
 	{
-		explicit if_null(Value& value, Value&& def=Value()) : m_value(value), m_def(std::move(def)) { }
-		void operator()(const binder& b)
+		if (stmt.m_binderAddins[index].m_isNull)
+			*static_cast<Value*>(value) = Value();
+	}
+
+	static void terminate_text(base_statement& stmt, size_t index, void* value)
+	{
+		const binder& b = stmt.m_binders[index];
+		char* text = static_cast<char*>(value);
+		if (*b.is_null)
+			memset(text, 0, b.buffer_length + 1);
+		else
+			text[*b.length] = '\0';
+	}
+
+	// The string is truncated to the length of each field, so it is enlarged to the buffer before the next row.
+	template<typename T>
+	static void grow_string(base_statement& stmt, size_t index, void* value)
+	{
+		bind_string_helper<T> text(std::move(*static_cast<T*>(value)));
+		binder& b = stmt.m_binders[index];
+		if (text.size() < b.buffer_length)
 		{
-			if(*b.is_null) m_value=m_def;
+			text.alloc(b.buffer_length);
+			if (b.buffer != text.data())
+			{
+				b.buffer = const_cast<char*>(text.data());
+				mysql_stmt_bind_result(stmt.m_stmt, &stmt.m_binders.front());
+			}
 		}
-		Value& m_value;
-		Value m_def;
-	};
+	}
+	/*
+		A value longer than the buffer is truncated by mysql_stmt_fetch,
+		the rest of it is read into the enlarged string, up to the string limit of the statement.
+		The larger buffer is bound for later rows, so it is read once when values are of similar length.
+	 */
+	template<typename T>
+	static void truncate_string(base_statement& stmt, size_t index, void* value)
+	{
+		bind_string_helper<T> text(std::move(*static_cast<T*>(value)));
+		binder_addin& addin = stmt.m_binderAddins[index];
+		if (addin.m_isNull)
+		{
+			text.clear();
+			return;
+		}
+		binder& b = stmt.m_binders[index];
+		unsigned long length = addin.m_length;
+		if (length > b.buffer_length)
+		{
+			unsigned long size = std::min(length, stmt.m_string_limit);
+			if (size > b.buffer_length)
+			{
+				unsigned long offset = b.buffer_length;
+				char* data = (char*)text.alloc(size);
+				binder rest = b;
+				rest.buffer = data + offset;
+				rest.buffer_length = size - offset;
+				if (mysql_stmt_fetch_column(stmt.m_stmt, &rest, (unsigned int)index, offset) != 0)
+					stmt.throw_exception();
+				b.buffer = data;
+				b.buffer_length = size;
+				if (mysql_stmt_bind_result(stmt.m_stmt, &stmt.m_binders.front()) != 0)
+					stmt.throw_exception();
+			}
+			addin.m_error = length > size;
+			length = size;
+		}
+		text.truncate(length);
+	}
+
+	static void read_stream(base_statement& stmt, size_t index, void* value)
+	{
+		std::ostream& stream = *static_cast<std::ostream*>(value);
+		binder& b = stmt.m_binders[index];
+		if (*b.is_null) return;
+		unsigned long readed = 0;
+		std::array<char, blob_buffer_size> buffer;
+		b.buffer = const_cast<char*>(buffer.data());
+		b.buffer_length = buffer.size();
+		while (readed <= *b.length)
+		{
+			int ret = mysql_stmt_fetch_column(stmt.m_stmt, &b, index, readed);
+			if (ret != 0)
+				stmt.throw_exception();
+			stream.write(buffer.data(), std::min(b.buffer_length, *b.length - b.offset));
+			readed += b.buffer_length;
+		}
+	}
+
+	static void open_blob(base_statement& stmt, size_t index, void* value)
+	{
+		const binder& b = stmt.m_binders[index];
+		if (*b.is_null) return;
+		static_cast<blobbuf*>(value)->open(stmt.m_stmt, index, b, std::ios::in);
+	}
+
+	template<typename Type>
+	static void set_indicator(base_statement& stmt, size_t index, void* value)
+	{
+		indicator<Type>& field = *static_cast<indicator<Type>*>(value);
+		const binder_addin& addin = stmt.m_binderAddins[index];
+		field.is_null = addin.m_isNull != 0;
+		field.length = addin.m_length;
+		field.is_truncated = addin.m_error != 0;
+	}
+
+	static void send_stream(base_statement& stmt, size_t index, void* value)
+	{
+		std::istream& param = *static_cast<std::istream*>(value);
+		std::array<char, blob_buffer_size> buffer;
+		unsigned long readed = 0;
+		while (!param.eof() && !param.fail())
+		{
+			param.read(buffer.data(), buffer.size());
+			readed = (unsigned long)param.gcount();
+			if (readed > 0)
+			{
+				if (mysql_stmt_send_long_data(stmt.m_stmt, index, buffer.data(), readed) != 0)
+					stmt.throw_exception();
+			}
+		}
+	}
+
+	static void write_blob(base_statement& stmt, size_t index, void* value)
+	{
+		blobbuf buf;
+		buf.open(stmt.m_stmt, index, stmt.m_binders[index], std::ios::out);
+		std::ostream s(&buf);
+		(*static_cast<const blob_writer*>(value))(s);
+	}
 
 };
 
 class statement : public base_statement
 {
 public:
-	statement() = default;
-	explicit statement(basic_database& db) : base_statement(db) { }
-	statement(statement&& src) : base_statement(std::move(src)) { }
+	statement() : m_bound_record(nullptr) { }
+	explicit statement(basic_database& db) : base_statement(db), m_bound_record(nullptr) { }
+	statement(statement&& src) : base_statement(std::move(src)), m_bound_record(src.m_bound_record) { }
 	statement& operator=(statement&& src) 
 	{
 		base_statement::operator =(std::move(src));
+		m_bound_record=src.m_bound_record;
 		return *this;
 	}
 	~statement()
@@ -800,6 +946,7 @@ public:
 
 		if (mysql_stmt_execute(m_stmt) != 0)
 			throw_exception();
+		store_result();
 	}
 
 	template<typename BindProc>
@@ -812,14 +959,11 @@ public:
 			bind_proc(*this);
 			if (mysql_stmt_bind_param(m_stmt, &m_binders.front()))
 				throw_exception();
-			for (size_t i = 0; i != count; i++)
-			{
-				if (m_binderAddins[i].m_after_fetch)
-					m_binderAddins[i].m_after_fetch(m_binders[i]);
-			}
+			run_steps(m_after_fetch);
 		}
 		if (mysql_stmt_execute(m_stmt) != 0)
 			throw_exception();
+		store_result();
 	}
 
 	template<typename Types>
@@ -830,6 +974,57 @@ public:
 		});
 	}
 
+	/*
+		MariaDB sends each batch in one round trip by array binding.
+		Values are not copied, the elements of params must be alive until the batch is executed.
+	 */
+	template<typename Range>
+	std::vector<uint64_t> execute_batch(const Range& params, size_t batch_size)
+	{
+		std::vector<uint64_t> affected;
+		auto it=std::begin(params);
+		auto last=std::end(params);
+#if MARIADB_VERSION_ID >= 100200
+		if(bulk_supported())
+		{
+			unsigned long count=mysql_stmt_param_count(m_stmt);
+			std::vector<bulk_param> columns(count);
+			while(it!=last)
+			{
+				unsigned int rows=0;
+				for(bulk_param& column : columns)
+					column.clear();
+				resize_binders(count);
+				for(; rows!=batch_size && it!=last; ++rows, ++it)
+				{
+					qtl::bind_params(*this, *it);
+					if(!m_after_fetch.empty())
+						throw mysql::error(CR_UNSUPPORTED_PARAM_TYPE, "Stream parameters can not be executed in batch");
+					for(unsigned long i=0; i!=count; i++)
+						columns[i].append(m_binders[i]);
+				}
+				for(unsigned long i=0; i!=count; i++)
+					columns[i].bind(m_binders[i]);
+				mysql_stmt_attr_set(m_stmt, STMT_ATTR_ARRAY_SIZE, &rows);
+				bool failed=(count>0 && mysql_stmt_bind_param(m_stmt, m_binders.data())) || mysql_stmt_execute(m_stmt)!=0;
+				unsigned int single=0;
+				mysql_stmt_attr_set(m_stmt, STMT_ATTR_ARRAY_SIZE, &single);
+				if(failed) throw_exception();
+				affected.push_back(mysql_stmt_affected_rows(m_stmt));
+			}
+			return affected;
+		}
+#endif //MariaDB 10.2
+		for(size_t i=0; it!=last; ++i, ++it)
+		{
+			if(i%batch_size==0) affected.push_back(0);
+			reset();
+			execute(*it);
+			affected.back()+=mysql_stmt_affected_rows(m_stmt);
+		}
+		return affected;
+	}
+
 	template<typename Types>
 	bool fetch(Types&& values)
 	{
@@ -841,31 +1036,37 @@ public:
 				m_result=mysql_stmt_result_metadata(m_stmt);
 				if(m_result==nullptr) throw_exception();
 				resize_binders(count);
-				qtl::bind_record(*this, std::forward<Types>(values));
-				set_binders();
-				if(mysql_stmt_bind_result(m_stmt, m_binders.data())!=0)
-					throw_exception();
+				m_bound_record=nullptr;
 			}
 		}
-		return fetch();
+		if(m_result && m_bound_record!=&values)
+		{
+			clear_steps();
+			qtl::plan_record(*this, values);
+			qtl::bind_record(*this, std::forward<Types>(values));
+			set_binders();
+			if(mysql_stmt_bind_result(m_stmt, m_binders.data())!=0)
+				throw_exception();
+			m_bound_record=&values;
+		}
+		if(!fetch()) return false;
+		qtl::complete_fetch(values);
+		return true;
+	}
+
+	template<typename Record, typename Alloc>
+	size_t fetch_n(std::vector<Record, Alloc>& values, size_t count)
+	{
+		return qtl::fetch_n(*this, values, count);
 	}
 
 	bool fetch()
 	{
-		for (size_t i = 0; i != m_binders.size(); i++)
-		{
-			if (m_binderAddins[i].m_before_fetch)
-				m_binderAddins[i].m_before_fetch(m_binders[i]);
-		}
+		run_steps(m_before_fetch);
 		int err=mysql_stmt_fetch(m_stmt);
 		if(err==0 || err==MYSQL_DATA_TRUNCATED)
 		{
-			for(size_t i=0; i!=m_binders.size(); i++)
-			{
-				m_binderAddins[i].is_truncated = (err==MYSQL_DATA_TRUNCATED);
-				if(m_binderAddins[i].m_after_fetch)
-					m_binderAddins[i].m_after_fetch(m_binders[i]);
-			}
+			run_steps(m_after_fetch);
 			return true;
 		}
 		else if(err==1)
@@ -887,10 +1088,124 @@ public:
 			ret=mysql_stmt_next_result(m_stmt);
 			if(ret>0) throw_exception();
 		}while(ret==0 && mysql_stmt_field_count(m_stmt)<=0);
-		return ret==0;
+		if(ret!=0) return false;
+		store_result();
+		return true;
 	}
 
-	bool reset() { return mysql_stmt_reset(m_stmt)!=0; }
+	bool reset()
+	{
+		if(m_result)
+		{
+			mysql_free_result(m_result);
+			m_result=nullptr;
+		}
+		return mysql_stmt_reset(m_stmt)!=0;
+	}
+
+private:
+	const void* m_bound_record;
+
+	void store_result()
+	{
+		if(need_store() && mysql_stmt_store_result(m_stmt)!=0)
+			throw_exception();
+	}
+
+#if MARIADB_VERSION_ID >= 100200
+	// values of a parameter in a batch, bound column-wise
+	struct bulk_param
+	{
+		enum_field_types m_type;
+		my_bool m_unsigned;
+		std::vector<void*> m_pointers;
+		std::vector<unsigned long> m_lengths;
+		std::vector<char> m_indicators;
+		std::vector<char> m_values;
+
+		void clear()
+		{
+			m_type=MYSQL_TYPE_NULL;
+			m_unsigned=false;
+			m_pointers.clear();
+			m_lengths.clear();
+			m_indicators.clear();
+		}
+		void append(const binder& b)
+		{
+			if(b.buffer_type==MYSQL_TYPE_NULL)
+			{
+				m_pointers.push_back(nullptr);
+				m_lengths.push_back(0);
+				m_indicators.push_back(STMT_INDICATOR_NULL);
+				return;
+			}
+			if(m_type==MYSQL_TYPE_NULL)
+			{
+				m_type=b.buffer_type;
+				m_unsigned=b.is_unsigned;
+			}
+			else if(m_type!=b.buffer_type)
+			{
+				throw mysql::error(CR_UNSUPPORTED_PARAM_TYPE, "Parameters in a batch must have the same type");
+			}
+			m_pointers.push_back(b.buffer);
+			m_lengths.push_back(b.length ? *b.length : b.buffer_length);
+			m_indicators.push_back(STMT_INDICATOR_NONE);
+		}
+		void bind(binder& b)
+		{
+			b.init();
+			b.buffer_type=(m_type==MYSQL_TYPE_NULL) ? MYSQL_TYPE_STRING : m_type;
+			b.is_unsigned=m_unsigned;
+			size_t width=value_size(b.buffer_type);
+			if(width>0)
+			{
+				// fixed-length values are passed in an array
+				m_values.resize(m_pointers.size()*width);
+				for(size_t i=0; i!=m_pointers.size(); i++)
+				{
+					if(m_pointers[i])
+						memcpy(&m_values[i*width], m_pointers[i], width);
+				}
+				b.buffer=m_values.data();
+			}
+			else
+			{
+				// others are passed in an array of pointers
+				b.buffer=m_pointers.data();
+			}
+			b.length=m_lengths.data();
+			b.u.indicator=m_indicators.data();
+		}
+		static size_t value_size(enum_field_types type)
+		{
+			switch(type)
+			{
+			case MYSQL_TYPE_TINY:
+				return 1;
+			case MYSQL_TYPE_SHORT:
+			case MYSQL_TYPE_YEAR:
+				return 2;
+			case MYSQL_TYPE_LONG:
+			case MYSQL_TYPE_INT24:
+			case MYSQL_TYPE_FLOAT:
+				return 4;
+			case MYSQL_TYPE_LONGLONG:
+			case MYSQL_TYPE_DOUBLE:
+				return 8;
+			default:
+				return 0;
+			}
+		}
+	};
+
+	bool bulk_supported() const
+	{
+		MYSQL* mysql=m_stmt->mysql;
+		return mariadb_connection(mysql) && mysql_get_server_version(mysql)>=100206;
+	}
+#endif //MariaDB 10.2
 };
 
 /*
@@ -904,37 +1219,57 @@ struct LocalInfile
 template<typename LocalInfile>
 struct local_infile_factory
 {
+	/*
+		Opens the source of a file requested by LOAD DATA LOCAL INFILE, the source is deleted after it is closed.
+		A derived factory can hide it, to open sources in another way.
+	 */
+	LocalInfile* create(const char* filename)
+	{
+		return new LocalInfile(filename);
+	}
+
+	template<typename Factory>
 	static int local_infile_init(void **ptr, const char *filename, void *userdata)
 	{
-		LocalInfile* object = nullptr;
+		Factory* factory = static_cast<Factory*>(userdata);
 		try
 		{
-			object = new LocalInfile(filename);
+			*ptr = factory->create(filename);
 		}
 		catch (...)
 		{
+			*ptr = nullptr;
 			return -1;
 		}
-		return ptr ? 0 : -1;
+		return 0;
 	}
 
 	static int local_infile_read(void *ptr, char *buf, unsigned int buf_len)
 	{
-		LocalInfile* object = reinterpret_cast<LocalInfile>(ptr);
+		LocalInfile* object = static_cast<LocalInfile*>(ptr);
 		return object->read(buf, buf_len);
 	}
 
 	static void local_infile_end(void *ptr)
 	{
-		LocalInfile* object = reinterpret_cast<LocalInfile>(ptr);
-		object->close();
-		delete object;
+		LocalInfile* object = static_cast<LocalInfile*>(ptr);
+		if (object)
+		{
+			object->close();
+			delete object;
+		}
 	}
 
+	// The client asks for the error of a source which is not opened too.
 	static int local_infile_error(void *ptr, char *error_msg, unsigned int error_msg_len)
 	{
-		LocalInfile* object = reinterpret_cast<LocalInfile>(ptr);
-		return object->error(error_msg, error_msg_len);
+		LocalInfile* object = static_cast<LocalInfile*>(ptr);
+		if (object)
+			return object->error(error_msg, error_msg_len);
+		int errcode = errno;
+		memset(error_msg, 0, error_msg_len);
+		strncpy(error_msg, strerror(errcode), error_msg_len - 1);
+		return errcode;
 	}
 };
 
@@ -970,7 +1305,7 @@ private:
 class basic_database
 {
 protected:
-	basic_database()
+	basic_database() : m_string_limit(unlimited_string), m_fetch_mode(mysql::fetch_mode::unbuffered), m_prefetch_rows(1)
 	{
 		m_mysql = mysql_init(nullptr);
 	}
@@ -987,6 +1322,9 @@ public:
 	basic_database(basic_database&& src)
 	{
 		m_mysql=src.m_mysql;
+		m_string_limit=src.m_string_limit;
+		m_fetch_mode=src.m_fetch_mode;
+		m_prefetch_rows=src.m_prefetch_rows;
 		src.m_mysql=nullptr;
 	}
 	basic_database& operator==(const basic_database&) = delete;
@@ -997,6 +1335,9 @@ public:
 			if(m_mysql)
 				mysql_close(m_mysql);
 			m_mysql=src.m_mysql;
+			m_string_limit=src.m_string_limit;
+			m_fetch_mode=src.m_fetch_mode;
+			m_prefetch_rows=src.m_prefetch_rows;
 			src.m_mysql=nullptr;
 		}
 		return *this;
@@ -1022,6 +1363,20 @@ public:
 	{
 		return options(MYSQL_OPT_RECONNECT, &re);
 	}
+	/*
+		Maximum length of a string field fetched by statements opened later,
+		longer values are truncated and reported by indicator::is_truncated.
+	 */
+	void set_string_limit(unsigned long limit) { m_string_limit = limit; }
+	unsigned long string_limit() const { return m_string_limit; }
+	// Sets how the rows are received by statements opened later, prefetch_rows is used by fetch_mode::cursor.
+	void set_fetch_mode(mysql::fetch_mode mode, unsigned long prefetch_rows = 1)
+	{
+		m_fetch_mode = mode;
+		m_prefetch_rows = prefetch_rows > 0 ? prefetch_rows : 1;
+	}
+	mysql::fetch_mode fetch_mode() const { return m_fetch_mode; }
+	unsigned long prefetch_rows() const { return m_prefetch_rows; }
 
 	const char* current() const
 	{
@@ -1054,6 +1409,9 @@ public:
 
 protected:
 	MYSQL* m_mysql;
+	unsigned long m_string_limit;
+	mysql::fetch_mode m_fetch_mode;
+	unsigned long m_prefetch_rows;
 	void throw_exception() { throw mysql::error(*this); }
 };
 
@@ -1076,6 +1434,7 @@ public:
 	}
 	void close()
 	{
+		clear_statement_cache();
 		mysql_close(m_mysql);
 		m_mysql = nullptr;
 	}
@@ -1169,20 +1528,20 @@ public:
 		return false;
 	}
 
-	template<typename LocalInfile>
-	void set_local_infile_factory(local_infile_factory<LocalInfile>* factory)
+	// Factory is local_infile_factory or a class derived from it.
+	template<typename Factory>
+	void set_local_infile_factory(Factory* factory)
 	{
-		typedef local_infile_factory<LocalInfile> factory_type;
 		if (factory == nullptr)
 		{
 			reset_local_infile();
 		}
 		else
 		{
-			mysql_set_local_infile_handler(m_mysql, &factory_type::local_infile_init,
-				&factory_type::local_infile_read,
-				&factory_type::local_infile_end,
-				&factory_type::local_infile_error, factory);
+			mysql_set_local_infile_handler(m_mysql, &Factory::template local_infile_init<Factory>,
+				&Factory::local_infile_read,
+				&Factory::local_infile_end,
+				&Factory::local_infile_error, factory);
 		}
 	}
 	void reset_local_infile()
@@ -1293,7 +1652,7 @@ public:
 		else if(ret)
 			handler(mysql::error(*this), 0);
 		else
-			handler(mysql::error(), affetced_rows());
+			after_execute(std::forward<ExecuteHandler>(handler));
 	}
 
 	template<typename Types, typename Handler>
@@ -1306,11 +1665,7 @@ public:
 			qtl::bind_params(*this, params);
 			if(mysql_stmt_bind_param(m_stmt, &m_binders.front()))
 				throw_exception();
-			for(size_t i=0; i!=count; i++)
-			{
-				if(m_binderAddins[i].m_after_fetch)
-					m_binderAddins[i].m_after_fetch(m_binders[i]);
-			}
+			run_steps(m_after_fetch);
 		}
 		execute(std::forward<Handler>(handler));
 	}
@@ -1326,6 +1681,7 @@ public:
 				m_result=mysql_stmt_result_metadata(m_stmt);
 				if(m_result==nullptr) throw_exception();
 				resize_binders(count);
+				qtl::plan_record(*this, values);
 				qtl::bind_record(*this, std::forward<Types>(values));
 				set_binders();
 				if(mysql_stmt_bind_result(m_stmt, m_binders.data())!=0)
@@ -1424,7 +1780,10 @@ public:
 				return;
 			}
 		}while(ret==0 && mysql_stmt_field_count(m_stmt)<=0);
-		handler((ret) ? mysql::error(*this) : mysql::error());
+		if (ret)
+			handler(mysql::error(*this));
+		else
+			store_result(std::forward<Handler>(handler));
 	}
 
 
@@ -1456,6 +1815,30 @@ private:
 		});
 	}
 
+	template<typename Handler>
+	void store_result(Handler&& handler)
+	{
+		int ret = 0;
+		if (need_store())
+		{
+			int status = mysql_stmt_store_result_start(&ret, m_stmt);
+			if (status)
+			{
+				wait_operation<int>(status, &mysql_stmt_store_result_cont, std::forward<Handler>(handler));
+				return;
+			}
+		}
+		handler((ret) ? mysql::error(*this) : mysql::error());
+	}
+
+	template<typename ExecuteHandler>
+	void after_execute(ExecuteHandler&& handler)
+	{
+		store_result([this, handler](const mysql::error& e) mutable {
+			handler(e, e ? 0 : affetced_rows());
+		});
+	}
+
 	template<typename ExecuteHandler>
 	void wait_execute(int status, ExecuteHandler&& handler)
 	{
@@ -1468,7 +1851,7 @@ private:
 				else if(ret)
 					handler(mysql::error(*this), 0);
 				else
-					handler(mysql::error(), affetced_rows());
+					after_execute(handler);
 		});
 	}
 
@@ -1488,11 +1871,7 @@ private:
 
 	int start_fetch(int* ret)
 	{
-		for (size_t i = 0; i != m_binders.size(); i++)
-		{
-			if (m_binderAddins[i].m_before_fetch)
-				m_binderAddins[i].m_before_fetch(m_binders[i]);
-		}
+		run_steps(m_before_fetch);
 		return mysql_stmt_fetch_start(ret, m_stmt);
 	}
 
@@ -1503,12 +1882,7 @@ private:
 		{
 			if (ret == 0 || ret == MYSQL_DATA_TRUNCATED)
 			{
-				for (size_t i = 0; i != m_binders.size(); i++)
-				{
-					m_binderAddins[i].is_truncated = (ret == MYSQL_DATA_TRUNCATED);
-					if (m_binderAddins[i].m_after_fetch)
-						m_binderAddins[i].m_after_fetch(m_binders[i]);
-				}
+				run_steps(m_after_fetch);
 				if (row_handler())
 					status = start_fetch(&ret);
 				else
@@ -1557,7 +1931,7 @@ private:
 			else if (ret)
 				handler(mysql::error(*this));
 			else if (mysql_stmt_field_count(m_stmt) > 0)
-				handler(mysql::error());
+				store_result(handler);
 			else
 				next_result(std::forward<Handler>(handler));
 		});
@@ -1938,10 +2312,25 @@ inline base_statement::base_statement(basic_database& db)
 {
 	m_stmt=mysql_stmt_init(db.handle());
 	m_result=nullptr;
+	m_string_limit=db.string_limit();
+	m_fetch_mode=db.fetch_mode();
+	m_prefetch_rows=db.prefetch_rows();
+	if(m_fetch_mode!=mysql::fetch_mode::unbuffered)
+		apply_fetch_mode();
 }
 
 }
 
+template<>
+struct batch_executor<mysql::statement>
+{
+	template<typename Range>
+	std::vector<uint64_t> operator()(mysql::statement& command, const Range& params, size_t batch_size) const
+	{
+		return command.execute_batch(params, batch_size);
+	}
+};
+
 }
 
 #endif //_QTL_MYSQL_H_
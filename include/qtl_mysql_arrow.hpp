@@ -0,0 +1,295 @@
+#ifndef _QTL_MYSQL_ARROW_H_
+#define _QTL_MYSQL_ARROW_H_
+
+#include "qtl_mysql.hpp"
+#include "qtl_arrow.hpp"
+
+namespace qtl
+{
+
+namespace mysql
+{
+
+/*
+	Reads the rows of an executed statement into Arrow arrays.
+	Columns are typed by their MYSQL_FIELD, DECIMAL columns are converted to strings.
+	The reader binds the result columns itself, so don't fetch the statement into records at the same time.
+ */
+class arrow_reader : public qtl::arrow::basic_reader<arrow_reader>
+{
+public:
+	explicit arrow_reader(statement& stmt) : m_stmt(stmt), m_result(nullptr), m_rebind(false)
+	{
+		MYSQL_STMT* handle = m_stmt;
+		if (mysql_stmt_field_count(handle) == 0)
+			return;
+		m_result = mysql_stmt_result_metadata(handle);
+		if (m_result == nullptr)
+			throw mysql::error(m_stmt);
+		unsigned int count = mysql_num_fields(m_result);
+		m_binds.resize(count);
+		m_columns.resize(count);
+		for (unsigned int i = 0; i != count; i++)
+		{
+			MYSQL_FIELD* field = mysql_fetch_field_direct(m_result, i);
+			qtl::arrow::type type = arrow_type(field);
+			// zero dates are read as null
+			bool nullable = (field->flags & NOT_NULL_FLAG) == 0 ||
+				type == qtl::arrow::type::date32 || type == qtl::arrow::type::timestamp;
+			add_column(field->name, type, nullable);
+			bind_column(i, field, type);
+		}
+		if (mysql_stmt_bind_result(handle, m_binds.data()) != 0)
+			throw mysql::error(m_stmt);
+	}
+	~arrow_reader()
+	{
+		if (m_result)
+			mysql_free_result(m_result);
+	}
+
+	bool fetch_row()
+	{
+		if (m_result == nullptr)
+			return false;
+		MYSQL_STMT* handle = m_stmt;
+		if (m_rebind)
+		{
+			if (mysql_stmt_bind_result(handle, m_binds.data()) != 0)
+				throw mysql::error(m_stmt);
+			m_rebind = false;
+		}
+		int ret = mysql_stmt_fetch(handle);
+		if (ret == 1)
+			throw mysql::error(m_stmt);
+		return ret == 0 || ret == MYSQL_DATA_TRUNCATED;
+	}
+
+	void read_field(size_t col, qtl::arrow::column_builder& column)
+	{
+		column_buffer& buffer = m_columns[col];
+		if (buffer.is_null)
+		{
+			column.append_null();
+			return;
+		}
+		switch (column.type())
+		{
+		case qtl::arrow::type::null:
+			column.append_null();
+			break;
+		case qtl::arrow::type::boolean:
+			column.append(buffer.data[0] != 0);
+			break;
+		case qtl::arrow::type::int8:
+		case qtl::arrow::type::uint8:
+			column.append(buffer.get<uint8_t>());
+			break;
+		case qtl::arrow::type::int16:
+		case qtl::arrow::type::uint16:
+			column.append(buffer.get<uint16_t>());
+			break;
+		case qtl::arrow::type::int32:
+		case qtl::arrow::type::uint32:
+			column.append(buffer.get<uint32_t>());
+			break;
+		case qtl::arrow::type::int64:
+		case qtl::arrow::type::uint64:
+			column.append(buffer.get<uint64_t>());
+			break;
+		case qtl::arrow::type::float32:
+			column.append(buffer.get<float>());
+			break;
+		case qtl::arrow::type::float64:
+			column.append(buffer.get<double>());
+			break;
+		case qtl::arrow::type::date32:
+		{
+			const MYSQL_TIME& t = buffer.value.time;
+			if (is_zero_date(t))
+				column.append_null();
+			else
+				column.append(qtl::arrow::days_from_civil(t.year, t.month, t.day));
+			break;
+		}
+		case qtl::arrow::type::timestamp:
+		{
+			const MYSQL_TIME& t = buffer.value.time;
+			if (is_zero_date(t))
+			{
+				column.append_null();
+				break;
+			}
+			int64_t seconds = qtl::arrow::days_from_civil(t.year, t.month, t.day) * INT64_C(86400) +
+				t.hour * 3600 + t.minute * 60 + t.second;
+			column.append(seconds * 1000000 + static_cast<int64_t>(t.second_part));
+			break;
+		}
+		case qtl::arrow::type::duration:
+		{
+			const MYSQL_TIME& t = buffer.value.time;
+			int64_t seconds = (static_cast<int64_t>(t.day) * 24 + t.hour) * 3600 + t.minute * 60 + t.second;
+			int64_t microseconds = seconds * 1000000 + static_cast<int64_t>(t.second_part);
+			column.append(t.neg ? -microseconds : microseconds);
+			break;
+		}
+		default:
+			if (buffer.length > m_binds[col].buffer_length)
+				fetch_long_field(col);
+			column.append(buffer.data.data(), buffer.length);
+			break;
+		}
+	}
+
+private:
+	struct column_buffer
+	{
+		union
+		{
+			char bytes[8];
+			MYSQL_TIME time;
+		} value;
+		std::vector<char> data;
+		unsigned long length;
+		my_bool is_null;
+		my_bool error;
+
+		template<typename T>
+		T get() const
+		{
+			T v;
+			memcpy(&v, value.bytes, sizeof(T));
+			return v;
+		}
+	};
+
+	statement& m_stmt;
+	MYSQL_RES* m_result;
+	std::vector<MYSQL_BIND> m_binds;
+	std::vector<column_buffer> m_columns;
+	bool m_rebind;
+
+	// Initial size of buffers of variable length columns, they grow when a longer field is fetched.
+	enum { initial_buffer_size = 256 };
+
+	static bool is_binary(const MYSQL_FIELD* field)
+	{
+		return field->charsetnr == 63;
+	}
+
+	static bool is_zero_date(const MYSQL_TIME& t)
+	{
+		return t.year == 0 && t.month == 0 && t.day == 0;
+	}
+
+	static qtl::arrow::type arrow_type(const MYSQL_FIELD* field)
+	{
+		bool is_unsigned = (field->flags & UNSIGNED_FLAG) != 0;
+		switch (field->type)
+		{
+		case MYSQL_TYPE_NULL:
+			return qtl::arrow::type::null;
+		case MYSQL_TYPE_BIT:
+			return field->length == 1 ? qtl::arrow::type::boolean : qtl::arrow::type::binary;
+		case MYSQL_TYPE_TINY:
+			return is_unsigned ? qtl::arrow::type::uint8 : qtl::arrow::type::int8;
+		case MYSQL_TYPE_SHORT:
+			return is_unsigned ? qtl::arrow::type::uint16 : qtl::arrow::type::int16;
+		case MYSQL_TYPE_YEAR:
+			return qtl::arrow::type::uint16;
+		case MYSQL_TYPE_INT24:
+		case MYSQL_TYPE_LONG:
+			return is_unsigned ? qtl::arrow::type::uint32 : qtl::arrow::type::int32;
+		case MYSQL_TYPE_LONGLONG:
+			return is_unsigned ? qtl::arrow::type::uint64 : qtl::arrow::type::int64;
+		case MYSQL_TYPE_FLOAT:
+			return qtl::arrow::type::float32;
+		case MYSQL_TYPE_DOUBLE:
+			return qtl::arrow::type::float64;
+		case MYSQL_TYPE_DATE:
+			return qtl::arrow::type::date32;
+		case MYSQL_TYPE_DATETIME:
+		case MYSQL_TYPE_TIMESTAMP:
+			return qtl::arrow::type::timestamp;
+		case MYSQL_TYPE_TIME:
+			return qtl::arrow::type::duration;
+		case MYSQL_TYPE_DECIMAL:
+		case MYSQL_TYPE_NEWDECIMAL:
+			return qtl::arrow::type::utf8;
+		default:
+			return is_binary(field) ? qtl::arrow::type::binary : qtl::arrow::type::utf8;
+		}
+	}
+
+	void bind_column(unsigned int index, const MYSQL_FIELD* field, qtl::arrow::type type)
+	{
+		MYSQL_BIND& bind = m_binds[index];
+		column_buffer& buffer = m_columns[index];
+		memset(&bind, 0, sizeof(MYSQL_BIND));
+		memset(&buffer.value, 0, sizeof(buffer.value));
+		bind.length = &buffer.length;
+		bind.is_null = &buffer.is_null;
+		bind.error = &buffer.error;
+		bind.is_unsigned = (field->flags & UNSIGNED_FLAG) != 0;
+		switch (type)
+		{
+		case qtl::arrow::type::null:
+			bind.buffer_type = MYSQL_TYPE_NULL;
+			break;
+		case qtl::arrow::type::int8:
+		case qtl::arrow::type::uint8:
+			bind.buffer_type = MYSQL_TYPE_TINY;
+			break;
+		case qtl::arrow::type::int16:
+		case qtl::arrow::type::uint16:
+			bind.buffer_type = MYSQL_TYPE_SHORT;
+			break;
+		case qtl::arrow::type::int32:
+		case qtl::arrow::type::uint32:
+			bind.buffer_type = MYSQL_TYPE_LONG;
+			break;
+		case qtl::arrow::type::int64:
+		case qtl::arrow::type::uint64:
+			bind.buffer_type = MYSQL_TYPE_LONGLONG;
+			break;
+		case qtl::arrow::type::float32:
+			bind.buffer_type = MYSQL_TYPE_FLOAT;
+			break;
+		case qtl::arrow::type::float64:
+			bind.buffer_type = MYSQL_TYPE_DOUBLE;
+			break;
+		case qtl::arrow::type::date32:
+		case qtl::arrow::type::timestamp:
+		case qtl::arrow::type::duration:
+			bind.buffer_type = field->type;
+			break;
+		default:
+			bind.buffer_type = type == qtl::arrow::type::utf8 ? MYSQL_TYPE_STRING : MYSQL_TYPE_BLOB;
+			buffer.data.resize(std::max<size_t>(std::min<size_t>(field->length, initial_buffer_size), 1));
+			bind.buffer = buffer.data.data();
+			bind.buffer_length = static_cast<unsigned long>(buffer.data.size());
+			return;
+		}
+		bind.buffer = &buffer.value;
+		bind.buffer_length = sizeof(buffer.value);
+	}
+
+	// Receives a truncated field, the buffer keeps its size for the next rows.
+	void fetch_long_field(size_t col)
+	{
+		column_buffer& buffer = m_columns[col];
+		MYSQL_BIND& bind = m_binds[col];
+		buffer.data.resize(buffer.length);
+		bind.buffer = buffer.data.data();
+		bind.buffer_length = buffer.length;
+		if (mysql_stmt_fetch_column(m_stmt, &bind, static_cast<unsigned int>(col), 0) != 0)
+			throw mysql::error(m_stmt);
+		m_rebind = true;
+	}
+};
+
+}
+
+}
+
+#endif //_QTL_MYSQL_ARROW_H_
@@ -0,0 +1,437 @@
+#ifndef _QTL_MYSQL_LOADER_H_
+#define _QTL_MYSQL_LOADER_H_
+
+#include <stdio.h>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <exception>
+#include <type_traits>
+#include "qtl_mysql.hpp"
+
+namespace qtl
+{
+
+namespace mysql
+{
+
+/*
+	Writes records as text in the default format of LOAD DATA:
+	fields are separated by tabs, rows end with a newline and NULL is written as \N.
+	Backslash, tab, newline, carriage return, NUL and Ctrl-Z in values are escaped by a backslash.
+	A record is bound like the parameters of a statement, by qtl::bind_params.
+ */
+class row_writer
+{
+public:
+	row_writer() : m_buffer(nullptr) { }
+	explicit row_writer(std::vector<char>& buffer) : m_buffer(&buffer) { }
+
+	// Rows are appended to buffer.
+	void attach(std::vector<char>& buffer) { m_buffer = &buffer; }
+
+	template<typename Record>
+	void write(const Record& record)
+	{
+		m_fields.clear();
+		m_values.clear();
+		qtl::bind_params(*this, record);
+		for (size_t i = 0; i != m_fields.size(); i++)
+		{
+			if (i > 0) m_buffer->push_back('\t');
+			const field& f = m_fields[i];
+			m_buffer->insert(m_buffer->end(), m_values.begin() + f.offset, m_values.begin() + f.offset + f.length);
+		}
+		m_buffer->push_back('\n');
+	}
+
+	void bind_param(size_t index, const char* value, size_t length)
+	{
+		begin_field(index);
+		escape(value, length);
+		end_field(index);
+	}
+	void bind_param(size_t index, const char* value)
+	{
+		if (value)
+			bind_param(index, value, strlen(value));
+		else
+			bind_param(index, nullptr);
+	}
+	void bind_param(size_t index, std::nullptr_t)
+	{
+		begin_field(index);
+		m_values.push_back('\\');
+		m_values.push_back('N');
+		end_field(index);
+	}
+	void bind_param(size_t index, qtl::null)
+	{
+		bind_param(index, nullptr);
+	}
+	void bind_param(size_t index, bool value)
+	{
+		begin_field(index);
+		m_values.push_back(value ? '1' : '0');
+		end_field(index);
+	}
+	template<typename T>
+	typename std::enable_if<std::is_integral<T>::value>::type bind_param(size_t index, const T& value)
+	{
+		typedef typename std::make_unsigned<T>::type unsigned_type;
+		char text[24];
+		char* last = text + sizeof(text);
+		char* p = last;
+		unsigned_type v = static_cast<unsigned_type>(value);
+		bool negative = value < 0;
+		if (negative) v = unsigned_type(0) - v;
+		do
+		{
+			*--p = '0' + v % 10;
+			v /= 10;
+		} while (v);
+		if (negative) *--p = '-';
+		begin_field(index);
+		m_values.insert(m_values.end(), p, last);
+		end_field(index);
+	}
+	void bind_param(size_t index, double value)
+	{
+		char text[32];
+		append(index, text, snprintf(text, sizeof(text), "%.17g", value));
+	}
+	void bind_param(size_t index, float value)
+	{
+		char text[32];
+		append(index, text, snprintf(text, sizeof(text), "%.9g", value));
+	}
+	void bind_param(size_t index, const MYSQL_TIME& value)
+	{
+		char text[48];
+		int n = 0;
+		switch (value.time_type)
+		{
+		case MYSQL_TIMESTAMP_DATE:
+			n = snprintf(text, sizeof(text), "%04u-%02u-%02u", value.year, value.month, value.day);
+			break;
+		case MYSQL_TIMESTAMP_TIME:
+			n = snprintf(text, sizeof(text), "%s%02u:%02u:%02u", value.neg ? "-" : "", value.hour, value.minute, value.second);
+			break;
+		case MYSQL_TIMESTAMP_DATETIME:
+			n = snprintf(text, sizeof(text), "%04u-%02u-%02u %02u:%02u:%02u",
+				value.year, value.month, value.day, value.hour, value.minute, value.second);
+			break;
+		default:
+			bind_param(index, nullptr);
+			return;
+		}
+		if (value.second_part > 0 && value.time_type != MYSQL_TIMESTAMP_DATE)
+			n += snprintf(text + n, sizeof(text) - n, ".%06lu", (unsigned long)value.second_part);
+		append(index, text, n);
+	}
+	void bind_param(size_t index, const const_blob_data& value)
+	{
+		bind_param(index, static_cast<const char*>(value.data), value.size);
+	}
+	void bind_param(size_t index, const blob_data& value)
+	{
+		bind_param(index, static_cast<const char*>(value.data), value.size);
+	}
+
+private:
+	struct field
+	{
+		size_t offset;
+		size_t length;
+	};
+	std::vector<char>* m_buffer;
+	// Fields may be bound in any order, so they are written here and joined in order.
+	std::vector<field> m_fields;
+	std::vector<char> m_values;
+
+	void begin_field(size_t index)
+	{
+		if (index >= m_fields.size())
+			m_fields.resize(index + 1);
+		m_fields[index].offset = m_values.size();
+	}
+	void end_field(size_t index)
+	{
+		m_fields[index].length = m_values.size() - m_fields[index].offset;
+	}
+	void append(size_t index, const char* text, int length)
+	{
+		begin_field(index);
+		m_values.insert(m_values.end(), text, text + length);
+		end_field(index);
+	}
+	void escape(const char* data, size_t length)
+	{
+		const char* start = data;
+		const char* last = data + length;
+		for (const char* p = data; p != last; ++p)
+		{
+			char c;
+			switch (*p)
+			{
+			case '\\': c = '\\'; break;
+			case '\t': c = 't'; break;
+			case '\n': c = 'n'; break;
+			case '\r': c = 'r'; break;
+			case '\0': c = '0'; break;
+			case '\x1a': c = 'Z'; break;
+			default: continue;
+			}
+			m_values.insert(m_values.end(), start, p);
+			m_values.push_back('\\');
+			m_values.push_back(c);
+			start = p + 1;
+		}
+		m_values.insert(m_values.end(), start, last);
+	}
+};
+
+class bulk_loader;
+
+// Source of LOAD DATA LOCAL INFILE opened by bulk_loader.
+class loader_infile
+{
+public:
+	explicit loader_infile(bulk_loader& loader) : m_loader(loader) { }
+	int read(char *buf, unsigned int buf_len);
+	void close();
+	int error(char *error_msg, unsigned int error_msg_len);
+
+private:
+	bulk_loader& m_loader;
+};
+
+/*
+	Loads records into a table by LOAD DATA LOCAL INFILE, straight from memory without temporary files.
+	A background thread writes rows into one of two buffers, while the client sends the other one to the server.
+	The buffers are kept by the loader, so they are allocated once for many loads.
+	LOCAL is agreed when the connection is opened, so set MYSQL_OPT_LOCAL_INFILE before open, the server must allow local_infile too.
+	The handler of the loader is installed only during a load, it never opens files.
+ */
+class bulk_loader : public local_infile_factory<loader_infile>
+{
+public:
+	/*
+		Producer defines as:
+		bool producer(qtl::mysql::row_writer& writer);
+		It writes rows by writer.write(record), and returns false when there are no more rows.
+		It is called by the background thread.
+	 */
+	typedef std::function<bool(row_writer&)> producer_type;
+
+	// Rows are sent to the server when a buffer holds more than buffer_size bytes.
+	explicit bulk_loader(size_t buffer_size = 1024 * 1024)
+		: m_buffer_size(buffer_size > 0 ? buffer_size : 1), m_write(0), m_read(0), m_offset(0),
+		m_reading(false), m_finished(true), m_cancelled(false)
+	{
+		m_ready[0] = m_ready[1] = false;
+	}
+	bulk_loader(const bulk_loader&) = delete;
+	bulk_loader& operator=(const bulk_loader&) = delete;
+	~bulk_loader()
+	{
+		stop();
+	}
+
+	/*
+		Loads the rows of producer, table is the clause after INTO TABLE,
+		such as "test(Name, CreateTime)" or "test CHARACTER SET utf8mb4 (Name, CreateTime)".
+		Returns count of rows loaded. An exception thrown by producer is thrown again here.
+		Throws mysql::error if the connection is opened without MYSQL_OPT_LOCAL_INFILE.
+	 */
+	uint64_t load_from(database& db, const char* table, producer_type producer)
+	{
+		MYSQL* handle = db.handle();
+		if ((handle->client_flag & CLIENT_LOCAL_FILES) == 0)
+			throw mysql::error(CR_UNKNOWN_ERROR, "LOAD DATA LOCAL INFILE needs MYSQL_OPT_LOCAL_INFILE set before the connection is opened");
+		std::string query_text("LOAD DATA LOCAL INFILE 'qtl_bulk_loader' INTO TABLE ");
+		query_text += table;
+		m_producer = std::move(producer);
+		m_exception = nullptr;
+		// the handlers of the connection are installed again after the load
+		const st_mysql_options& options = handle->options;
+		auto infile_init = options.local_infile_init;
+		auto infile_read = options.local_infile_read;
+		auto infile_end = options.local_infile_end;
+		auto infile_error = options.local_infile_error;
+		void* infile_userdata = options.local_infile_userdata;
+		db.set_local_infile_factory(this);
+		int ret = mysql_real_query(handle, query_text.data(), (unsigned long)query_text.size());
+		mysql_set_local_infile_handler(handle, infile_init, infile_read, infile_end, infile_error, infile_userdata);
+		stop();
+		m_producer = nullptr;
+		if (m_exception)
+			std::rethrow_exception(m_exception);
+		if (ret != 0)
+			throw mysql::error(db);
+		return db.affected_rows();
+	}
+
+	// Loads each element of records as a row.
+	template<typename Range>
+	uint64_t load(database& db, const char* table, const Range& records)
+	{
+		auto it = std::begin(records);
+		auto last = std::end(records);
+		return load_from(db, table, [&it, &last](row_writer& writer) {
+			if (it == last) return false;
+			writer.write(*it);
+			return ++it != last;
+		});
+	}
+
+	loader_infile* create(const char* /*filename*/)
+	{
+		stop();
+		for (size_t i = 0; i != 2; i++)
+		{
+			m_buffers[i].clear();
+			m_ready[i] = false;
+		}
+		m_write = m_read = m_offset = 0;
+		m_reading = false;
+		m_finished = m_cancelled = false;
+		m_thread = std::thread(&bulk_loader::produce, this);
+		return new loader_infile(*this);
+	}
+
+private:
+	friend class loader_infile;
+
+	size_t m_buffer_size;
+	std::vector<char> m_buffers[2];
+	bool m_ready[2]; // the buffer is written and waits to be sent
+	size_t m_write; // buffer written by the background thread
+	size_t m_read; // buffer sent by the client
+	size_t m_offset; // offset sent in m_buffers[m_read]
+	bool m_reading; // the client owns m_buffers[m_read], and reads it without locking
+	bool m_finished;
+	bool m_cancelled;
+	std::mutex m_mutex;
+	std::condition_variable m_cv;
+	std::thread m_thread;
+	row_writer m_writer;
+	producer_type m_producer;
+	std::exception_ptr m_exception;
+
+	void produce()
+	{
+		try
+		{
+			bool more = true;
+			while (more)
+			{
+				{
+					std::unique_lock<std::mutex> lock(m_mutex);
+					m_cv.wait(lock, [this]() { return !m_ready[m_write] || m_cancelled; });
+					if (m_cancelled) break;
+				}
+				std::vector<char>& buffer = m_buffers[m_write];
+				buffer.clear();
+				m_writer.attach(buffer);
+				while (more && buffer.size() < m_buffer_size)
+					more = m_producer(m_writer);
+				std::lock_guard<std::mutex> lock(m_mutex);
+				m_ready[m_write] = true;
+				m_write ^= 1;
+				m_cv.notify_all();
+			}
+		}
+		catch (...)
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_exception = std::current_exception();
+		}
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_finished = true;
+		m_cv.notify_all();
+	}
+
+	int read(char *buf, unsigned int buf_len)
+	{
+		for (;;)
+		{
+			if (m_reading)
+			{
+				const std::vector<char>& buffer = m_buffers[m_read];
+				if (m_offset < buffer.size())
+				{
+					size_t n = std::min<size_t>(buf_len, buffer.size() - m_offset);
+					memcpy(buf, buffer.data() + m_offset, n);
+					m_offset += n;
+					return static_cast<int>(n);
+				}
+				std::lock_guard<std::mutex> lock(m_mutex);
+				m_ready[m_read] = false;
+				m_read ^= 1;
+				m_offset = 0;
+				m_reading = false;
+				m_cv.notify_all();
+			}
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_cv.wait(lock, [this]() { return m_ready[m_read] || m_finished; });
+			if (!m_ready[m_read])
+				return m_exception ? -1 : 0;
+			m_reading = true;
+		}
+	}
+
+	int error(char *error_msg, unsigned int error_msg_len)
+	{
+		std::string message("Rows of bulk_loader are not produced");
+		try
+		{
+			if (m_exception)
+				std::rethrow_exception(m_exception);
+		}
+		catch (std::exception& e)
+		{
+			message = e.what();
+		}
+		catch (...)
+		{
+		}
+		memset(error_msg, 0, error_msg_len);
+		strncpy(error_msg, message.data(), error_msg_len - 1);
+		return CR_UNKNOWN_ERROR;
+	}
+
+	void stop()
+	{
+		if (m_thread.joinable())
+		{
+			{
+				std::lock_guard<std::mutex> lock(m_mutex);
+				m_cancelled = true;
+				m_cv.notify_all();
+			}
+			m_thread.join();
+		}
+	}
+};
+
+inline int loader_infile::read(char *buf, unsigned int buf_len)
+{
+	return m_loader.read(buf, buf_len);
+}
+
+inline void loader_infile::close()
+{
+	m_loader.stop();
+}
+
+inline int loader_infile::error(char *error_msg, unsigned int error_msg_len)
+{
+	return m_loader.error(error_msg, error_msg_len);
+}
+
+}
+
+}
+
+#endif //_QTL_MYSQL_LOADER_H_
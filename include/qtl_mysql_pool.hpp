@@ -48,6 +48,12 @@ public:
 	async_pool(EventLoop& ev) : base_class(ev), m_port(0) { }
 	virtual ~async_pool() { }
 
+	// Requests still waiting for connections fail with it when the pool is destroyed.
+	static typename base_class::exception_type closed_error()
+	{
+		return mysql::error(CR_UNKNOWN_ERROR, "the connection pool is destroyed");
+	}
+
 	template<typename Handler>
 	void new_connection(EventLoop& ev, Handler&& handler) throw()
 	{
@@ -178,6 +178,7 @@ public:
 		: object(std::forward<base_statement>(src)), m_params(std::forward<std::vector<param_data>>(src.m_params))
 	{
 		m_binded_cols=src.m_binded_cols;
+		m_binded_record=src.m_binded_record;
 		src.m_binded_cols=false;
 		m_blob_buffer=src.m_blob_buffer;
 		src.m_blob_buffer=NULL;
@@ -194,6 +195,7 @@ public:
 			object::operator =(std::forward<base_statement>(src));
 			m_params=std::forward<std::vector<param_data>>(src.m_params);
 			m_binded_cols=src.m_binded_cols;
+			m_binded_record=src.m_binded_record;
 			src.m_binded_cols=false;
 			m_blob_buffer=src.m_blob_buffer;
 			src.m_blob_buffer=NULL;
@@ -204,8 +206,7 @@ public:
 	void bind_param(size_t index, const std::nullptr_t&)
 	{
 		m_params[index].m_indicator=SQL_NULL_DATA;
-		verify_error(SQLBindParameter(m_handle, static_cast<SQLUSMALLINT>(index+1), 
-			SQL_PARAM_INPUT, SQL_C_DEFAULT, SQL_DEFAULT, 0, 0, NULL, 0, &m_params[index].m_indicator));
+		bind_parameter(index, SQL_C_DEFAULT, SQL_DEFAULT, 0, 0, NULL, 0, &m_params[index].m_indicator);
 	}
 	void bind_param(size_t index, const qtl::null&)
 	{
@@ -213,97 +214,97 @@ public:
 	}
 	void bind_param(size_t index, const int8_t& v)
 	{
-		verify_error(SQLBindParameter(m_handle, static_cast<SQLUSMALLINT>(index+1), SQL_PARAM_INPUT, SQL_C_STINYINT, SQL_TINYINT, 
-			0, 0, (SQLPOINTER)&v, 0, NULL));
+		bind_parameter(index, SQL_C_STINYINT, SQL_TINYINT, 
+			0, 0, (SQLPOINTER)&v, 0, NULL);
 	}
 	void bind_param(size_t index, const uint8_t& v)
 	{
-		verify_error(SQLBindParameter(m_handle, static_cast<SQLUSMALLINT>(index+1), SQL_PARAM_INPUT, SQL_C_UTINYINT, SQL_TINYINT, 
-			0, 0, (SQLPOINTER)&v, 0, NULL));
+		bind_parameter(index, SQL_C_UTINYINT, SQL_TINYINT, 
+			0, 0, (SQLPOINTER)&v, 0, NULL);
 	}
 	void bind_param(size_t index, const int16_t& v)
 	{
-		verify_error(SQLBindParameter(m_handle, static_cast<SQLUSMALLINT>(index+1), SQL_PARAM_INPUT, SQL_C_SSHORT, SQL_SMALLINT, 
-			0, 0, (SQLPOINTER)&v, 0, NULL));
+		bind_parameter(index, SQL_C_SSHORT, SQL_SMALLINT, 
+			0, 0, (SQLPOINTER)&v, 0, NULL);
 	}
 	void bind_param(size_t index, const uint16_t& v)
 	{
-		verify_error(SQLBindParameter(m_handle, static_cast<SQLUSMALLINT>(index+1), SQL_PARAM_INPUT, SQL_C_USHORT, SQL_SMALLINT, 
-			0, 0, (SQLPOINTER)&v, 0, NULL));
+		bind_parameter(index, SQL_C_USHORT, SQL_SMALLINT, 
+			0, 0, (SQLPOINTER)&v, 0, NULL);
 	}
 	void bind_param(size_t index, const int32_t& v)
 	{
-		verify_error(SQLBindParameter(m_handle, static_cast<SQLUSMALLINT>(index+1), SQL_PARAM_INPUT, SQL_C_SLONG, SQL_INTEGER, 
-			0, 0, (SQLPOINTER)&v, 0, NULL));
+		bind_parameter(index, SQL_C_SLONG, SQL_INTEGER, 
+			0, 0, (SQLPOINTER)&v, 0, NULL);
 	}
 	void bind_param(size_t index, const uint32_t& v)
 	{
-		verify_error(SQLBindParameter(m_handle, static_cast<SQLUSMALLINT>(index+1), SQL_PARAM_INPUT, SQL_C_ULONG, SQL_INTEGER, 
-			0, 0, (SQLPOINTER)&v, 0, NULL));
+		bind_parameter(index, SQL_C_ULONG, SQL_INTEGER, 
+			0, 0, (SQLPOINTER)&v, 0, NULL);
 	}
 	void bind_param(size_t index, const int64_t& v)
 	{
-		verify_error(SQLBindParameter(m_handle, static_cast<SQLUSMALLINT>(index+1), SQL_PARAM_INPUT, SQL_C_SBIGINT, SQL_BIGINT, 
-			0, 0, (SQLPOINTER)&v, 0, NULL));
+		bind_parameter(index, SQL_C_SBIGINT, SQL_BIGINT, 
+			0, 0, (SQLPOINTER)&v, 0, NULL);
 	}
 	void bind_param(size_t index, const uint64_t& v)
 	{
-		verify_error(SQLBindParameter(m_handle, static_cast<SQLUSMALLINT>(index+1), SQL_PARAM_INPUT, SQL_C_UBIGINT, SQL_BIGINT, 
-			0, 0, (SQLPOINTER)&v, 0, NULL));
+		bind_parameter(index, SQL_C_UBIGINT, SQL_BIGINT, 
+			0, 0, (SQLPOINTER)&v, 0, NULL);
 	}
 	void bind_param(size_t index, const double& v)
 	{
-		verify_error(SQLBindParameter(m_handle, static_cast<SQLUSMALLINT>(index+1), SQL_PARAM_INPUT, SQL_C_DOUBLE, SQL_DOUBLE, 
-			0, 0, (SQLPOINTER)&v, 0, NULL));
+		bind_parameter(index, SQL_C_DOUBLE, SQL_DOUBLE, 
+			0, 0, (SQLPOINTER)&v, 0, NULL);
 	}
 	void bind_param(size_t index, const float& v)
 	{
-		verify_error(SQLBindParameter(m_handle, static_cast<SQLUSMALLINT>(index+1), SQL_PARAM_INPUT, SQL_C_FLOAT, SQL_FLOAT, 
-			0, 0, (SQLPOINTER)&v, 0, NULL));
+		bind_parameter(index, SQL_C_FLOAT, SQL_FLOAT, 
+			0, 0, (SQLPOINTER)&v, 0, NULL);
 	}
 	void bind_param(size_t index, const bool& v)
 	{
-		verify_error(SQLBindParameter(m_handle, static_cast<SQLUSMALLINT>(index+1), SQL_PARAM_INPUT, SQL_C_BIT, SQL_BIT, 
-			0, 0, (SQLPOINTER)&v, 0, NULL));
+		bind_parameter(index, SQL_C_BIT, SQL_BIT, 
+			0, 0, (SQLPOINTER)&v, 0, NULL);
 	}
 	void bind_param(size_t index, const DATE_STRUCT& v)
 	{
-		verify_error(SQLBindParameter(m_handle, static_cast<SQLUSMALLINT>(index+1), SQL_PARAM_INPUT, SQL_C_DATE, SQL_DATE, 
-			0, 0, (SQLPOINTER)&v, 0, NULL));
+		bind_parameter(index, SQL_C_DATE, SQL_DATE, 
+			0, 0, (SQLPOINTER)&v, 0, NULL);
 	}
 	void bind_param(size_t index, const TIME_STRUCT& v)
 	{
-		verify_error(SQLBindParameter(m_handle, static_cast<SQLUSMALLINT>(index+1), SQL_PARAM_INPUT, SQL_C_TIME, SQL_TIME, 
-			0, 0, (SQLPOINTER)&v, 0, NULL));
+		bind_parameter(index, SQL_C_TIME, SQL_TIME, 
+			0, 0, (SQLPOINTER)&v, 0, NULL);
 	}
 	void bind_param(size_t index, const TIMESTAMP_STRUCT& v)
 	{
-		verify_error(SQLBindParameter(m_handle, static_cast<SQLUSMALLINT>(index+1), SQL_PARAM_INPUT, SQL_C_TIMESTAMP, SQL_TIMESTAMP, 
-			0, 0, (SQLPOINTER)&v, 0, NULL));
+		bind_parameter(index, SQL_C_TIMESTAMP, SQL_TIMESTAMP, 
+			0, 0, (SQLPOINTER)&v, 0, NULL);
 	}
 	void bind_param(size_t index, const SQLGUID& v)
 	{
-		verify_error(SQLBindParameter(m_handle, static_cast<SQLUSMALLINT>(index+1), SQL_PARAM_INPUT, SQL_C_GUID, SQL_GUID, 
-			0, 0, (SQLPOINTER)&v, 0, NULL));
+		bind_parameter(index, SQL_C_GUID, SQL_GUID, 
+			0, 0, (SQLPOINTER)&v, 0, NULL);
 	}
 	void bind_param(size_t index, const SQL_NUMERIC_STRUCT& v)
 	{
-		verify_error(SQLBindParameter(m_handle, static_cast<SQLUSMALLINT>(index+1), SQL_PARAM_INPUT, SQL_C_NUMERIC, SQL_NUMERIC, 
-			0, 0, (SQLPOINTER)&v, 0, NULL));
+		bind_parameter(index, SQL_C_NUMERIC, SQL_NUMERIC, 
+			0, 0, (SQLPOINTER)&v, 0, NULL);
 	}
 	void bind_param(size_t index, const char* v, size_t n=SQL_NTS, SQLULEN size=0)
 	{
 		m_params[index].m_indicator=n;
 		if(size==0) size=strlen(v);
-		verify_error(SQLBindParameter(m_handle, static_cast<SQLUSMALLINT>(index+1), SQL_PARAM_INPUT, SQL_C_CHAR, SQL_CHAR, 
-			size, 0, (SQLPOINTER)v, 0, &m_params[index].m_indicator));
+		bind_parameter(index, SQL_C_CHAR, SQL_CHAR, 
+			size, 0, (SQLPOINTER)v, 0, &m_params[index].m_indicator);
 	}
 	void bind_param(size_t index, const wchar_t* v, size_t n=SQL_NTS, SQLULEN size=0)
 	{
 		m_params[index].m_indicator=n;
 		if(size==0) size=wcslen(v);
-		verify_error(SQLBindParameter(m_handle, static_cast<SQLUSMALLINT>(index+1), SQL_PARAM_INPUT, SQL_C_WCHAR, SQL_WCHAR, 
-			size, 0, (SQLPOINTER)v, 0, &m_params[index].m_indicator));
+		bind_parameter(index, SQL_C_WCHAR, SQL_WCHAR, 
+			size, 0, (SQLPOINTER)v, 0, &m_params[index].m_indicator);
 	}
 	void bind_param(size_t index, const std::string& v)
 	{
@@ -316,8 +317,8 @@ public:
 	void bind_param(size_t index, const const_blob_data& v)
 	{
 		m_params[index].m_indicator=v.size;
-		verify_error(SQLBindParameter(m_handle, static_cast<SQLUSMALLINT>(index+1), SQL_PARAM_INPUT, SQL_C_BINARY, SQL_BINARY, 
-			v.size, 0, (SQLPOINTER)v.data, 0, &m_params[index].m_indicator));
+		bind_parameter(index, SQL_C_BINARY, SQL_BINARY, 
+			v.size, 0, (SQLPOINTER)v.data, 0, &m_params[index].m_indicator);
 	}
 	void bind_param(size_t index, std::istream& s)
 	{
@@ -326,8 +327,8 @@ public:
 		m_params[index].m_data=m_blob_buffer;
 		m_params[index].m_size=blob_buffer_size;
 		m_params[index].m_indicator=SQL_LEN_DATA_AT_EXEC(m_params[index].m_size);
-		verify_error(SQLBindParameter(m_handle, static_cast<SQLUSMALLINT>(index+1), SQL_PARAM_INPUT, SQL_C_BINARY, SQL_LONGVARBINARY, 
-			INT_MAX, 0, &m_params[index], 0, &m_params[index].m_indicator));
+		bind_parameter(index, SQL_C_BINARY, SQL_LONGVARBINARY, 
+			INT_MAX, 0, &m_params[index], 0, &m_params[index].m_indicator);
 		m_params[index].m_after_fetch=[this, &s](const param_data& p) {
 			SQLLEN readed=SQL_NULL_DATA;
 			while(!s.eof() && !s.fail())
@@ -347,8 +348,8 @@ public:
 		m_params[index].m_data = nullptr;
 		m_params[index].m_size = blob_buffer_size;
 		m_params[index].m_indicator = SQL_LEN_DATA_AT_EXEC(m_params[index].m_size);
-		verify_error(SQLBindParameter(m_handle, static_cast<SQLSMALLINT>(index + 1), SQL_PARAM_INPUT, SQL_C_BINARY, SQL_LONGVARBINARY,
-			INT_MAX, 0, &m_params[index], 0, &m_params[index].m_indicator));
+		bind_parameter(index, SQL_C_BINARY, SQL_LONGVARBINARY,
+			INT_MAX, 0, &m_params[index], 0, &m_params[index].m_indicator);
 		m_params[index].m_after_fetch = [this, index, &param](const param_data& b) {
 			blobbuf buf;
 			buf.open(this, static_cast<SQLSMALLINT>(index), std::ios::out);
@@ -712,7 +713,10 @@ public:
 
 	void reset()
 	{
+		verify_error(SQLFreeStmt(m_handle, SQL_CLOSE));
+		verify_error(SQLFreeStmt(m_handle, SQL_UNBIND));
 		verify_error(SQLFreeStmt(m_handle, SQL_RESET_PARAMS));
+		m_binded_cols=false;
 	}
 
 	/*
@@ -735,11 +739,35 @@ protected:
 		SQLLEN m_indicator;
 		std::function<void(const param_data&)> m_after_fetch;
 
-		param_data() : m_data(NULL), m_size(0), m_indicator(0) { }
+		// arguments of SQLBindParameter
+		SQLSMALLINT m_value_type;
+		SQLSMALLINT m_param_type;
+		SQLULEN m_column_size;
+		SQLSMALLINT m_digits;
+		SQLPOINTER m_value;
+		SQLLEN* m_length;
+
+		param_data() : m_data(NULL), m_size(0), m_indicator(0), 
+			m_value_type(SQL_C_DEFAULT), m_param_type(SQL_DEFAULT), m_column_size(0), m_digits(0), m_value(NULL), m_length(NULL) { }
 	};
 	SQLPOINTER m_blob_buffer;
 	std::vector<param_data> m_params;
 	bool m_binded_cols;
+	const void* m_binded_record;
+
+	void bind_parameter(size_t index, SQLSMALLINT value_type, SQLSMALLINT param_type, 
+		SQLULEN column_size, SQLSMALLINT digits, SQLPOINTER value, SQLLEN buffer_length, SQLLEN* length)
+	{
+		param_data& param=m_params[index];
+		param.m_value_type=value_type;
+		param.m_param_type=param_type;
+		param.m_column_size=column_size;
+		param.m_digits=digits;
+		param.m_value=value;
+		param.m_length=length;
+		verify_error(SQLBindParameter(m_handle, static_cast<SQLUSMALLINT>(index+1), SQL_PARAM_INPUT, 
+			value_type, param_type, column_size, digits, value, buffer_length, length));
+	}
 };
 
 class statement : public base_statement
@@ -824,21 +852,94 @@ public:
 		}
 	}
 
+	/*
+		Each batch is sent in one round trip by binding arrays of parameters.
+		The values of parameters are copied into the arrays.
+	 */
+	template<typename Range>
+	std::vector<uint64_t> execute_batch(const Range& params, size_t batch_size)
+	{
+		std::vector<uint64_t> affected;
+		SQLSMALLINT count=get_parameter_count();
+		std::vector<bulk_param> columns(count);
+		auto it=std::begin(params);
+		auto last=std::end(params);
+		m_params.resize(count);
+		verify_error(SQLSetStmtAttr(m_handle, SQL_ATTR_PARAM_BIND_TYPE, (SQLPOINTER)SQL_PARAM_BIND_BY_COLUMN, 0));
+		try
+		{
+			while(it!=last)
+			{
+				SQLULEN rows=0;
+				for(bulk_param& column : columns)
+					column.clear();
+				for(; rows!=batch_size && it!=last; ++rows, ++it)
+				{
+					for(param_data& param : m_params)
+						param.m_after_fetch=nullptr;
+					qtl::bind_params(*this, *it);
+					for(SQLSMALLINT i=0; i!=count; i++)
+					{
+						if(m_params[i].m_after_fetch)
+							throw error(SQL_ERROR, "Stream parameters can not be executed in batch.");
+						columns[i].append(m_params[i]);
+					}
+				}
+				for(SQLSMALLINT i=0; i!=count; i++)
+					columns[i].bind(*this, i);
+				verify_error(SQLSetStmtAttr(m_handle, SQL_ATTR_PARAMSET_SIZE, (SQLPOINTER)rows, 0));
+				SQLRETURN ret=SQLExecute(m_handle);
+				verify_error(ret);
+				SQLLEN rowcount=0;
+				if(ret!=SQL_NO_DATA)
+					verify_error(SQLRowCount(m_handle, &rowcount));
+				affected.push_back(rowcount>0 ? rowcount : 0);
+				verify_error(SQLFreeStmt(m_handle, SQL_CLOSE));
+			}
+		}
+		catch(...)
+		{
+			reset_bulk();
+			throw;
+		}
+		reset_bulk();
+		return affected;
+	}
+
 	template<typename Types>
 	bool fetch(Types&& values)
 	{
-		if (!m_binded_cols)
+		if (!m_binded_cols || m_binded_record != &values)
 		{
 			SQLSMALLINT count = 0;
 			verify_error(SQLNumResultCols(m_handle, &count));
 			if (count > 0)
 			{
 				m_params.resize(count);
+				qtl::plan_record(*this, values);
 				qtl::bind_record(*this, std::forward<Types>(values));
 			}
 			m_binded_cols = true;
+			m_binded_record = &values;
 		}
-		return fetch();
+		if (!fetch()) return false;
+		qtl::complete_fetch(values);
+		return true;
+	}
+
+	template<typename Record, typename Alloc>
+	size_t fetch_n(std::vector<Record, Alloc>& values, size_t count)
+	{
+		return qtl::fetch_n(*this, values, count);
+	}
+
+	// Returns the count of rows if the driver reports it, otherwise 0.
+	size_t get_row_count()
+	{
+		SQLLEN count = 0;
+		if (!SQL_SUCCEEDED(SQLRowCount(m_handle, &count)) || count < 0)
+			return 0;
+		return count;
 	}
 
 	bool fetch()
@@ -871,6 +972,125 @@ public:
 		} while (count == 0);
 		return ret == SQL_SUCCESS || ret == SQL_SUCCESS_WITH_INFO;
 	}
+
+private:
+	// Parameters of a batch are bound to the buffers of bulk_param, they must not be used after it.
+	void reset_bulk()
+	{
+		SQLFreeStmt(m_handle, SQL_RESET_PARAMS);
+		SQLSetStmtAttr(m_handle, SQL_ATTR_PARAMSET_SIZE, (SQLPOINTER)1, 0);
+	}
+
+	// values of a parameter in a batch, bound column-wise
+	struct bulk_param
+	{
+		SQLSMALLINT m_value_type;
+		SQLSMALLINT m_param_type;
+		SQLULEN m_column_size;
+		SQLSMALLINT m_digits;
+		std::vector<const void*> m_pointers;
+		std::vector<SQLLEN> m_indicators;
+		std::vector<char> m_values;
+
+		void clear()
+		{
+			m_value_type=SQL_C_DEFAULT;
+			m_param_type=SQL_DEFAULT;
+			m_column_size=0;
+			m_digits=0;
+			m_pointers.clear();
+			m_indicators.clear();
+		}
+		void append(const param_data& param)
+		{
+			SQLLEN length=param.m_length ? *param.m_length : value_size(param.m_value_type);
+			if(length==SQL_NULL_DATA || param.m_value==NULL)
+			{
+				m_pointers.push_back(NULL);
+				m_indicators.push_back(SQL_NULL_DATA);
+				return;
+			}
+			if(m_value_type==SQL_C_DEFAULT)
+			{
+				m_value_type=param.m_value_type;
+				m_param_type=param.m_param_type;
+				m_digits=param.m_digits;
+			}
+			else if(m_value_type!=param.m_value_type)
+			{
+				throw error(SQL_ERROR, "Parameters in a batch must have the same type.");
+			}
+			if(length==SQL_NTS)
+			{
+				if(m_value_type==SQL_C_WCHAR)
+					length=wcslen((const wchar_t*)param.m_value)*sizeof(wchar_t);
+				else
+					length=strlen((const char*)param.m_value);
+			}
+			m_column_size=std::max(m_column_size, param.m_column_size);
+			m_pointers.push_back(param.m_value);
+			m_indicators.push_back(length);
+		}
+		void bind(base_statement& stmt, SQLSMALLINT index)
+		{
+			if(m_value_type==SQL_C_DEFAULT)
+			{
+				m_value_type=SQL_C_CHAR;
+				m_param_type=SQL_VARCHAR;
+			}
+			SQLLEN width=value_size(m_value_type);
+			if(width==0)
+			{
+				width=1;
+				for(SQLLEN length : m_indicators)
+					width=std::max(width, length);
+			}
+			m_values.resize(m_pointers.size()*width);
+			for(size_t i=0; i!=m_pointers.size(); i++)
+			{
+				if(m_pointers[i])
+					memcpy(&m_values[i*width], m_pointers[i], m_indicators[i]);
+			}
+			stmt.verify_error(SQLBindParameter(stmt.handle(), static_cast<SQLUSMALLINT>(index+1), SQL_PARAM_INPUT, 
+				m_value_type, m_param_type, m_column_size, m_digits, m_values.data(), width, m_indicators.data()));
+		}
+		static SQLLEN value_size(SQLSMALLINT type)
+		{
+			switch(type)
+			{
+			case SQL_C_BIT:
+			case SQL_C_STINYINT:
+			case SQL_C_UTINYINT:
+				return 1;
+			case SQL_C_SSHORT:
+			case SQL_C_USHORT:
+				return 2;
+			case SQL_C_SLONG:
+			case SQL_C_ULONG:
+			case SQL_C_FLOAT:
+				return 4;
+			case SQL_C_SBIGINT:
+			case SQL_C_UBIGINT:
+			case SQL_C_DOUBLE:
+				return 8;
+			case SQL_C_DATE:
+			case SQL_C_TYPE_DATE:
+				return sizeof(DATE_STRUCT);
+			case SQL_C_TIME:
+			case SQL_C_TYPE_TIME:
+				return sizeof(TIME_STRUCT);
+			case SQL_C_TIMESTAMP:
+			case SQL_C_TYPE_TIMESTAMP:
+				return sizeof(TIMESTAMP_STRUCT);
+			case SQL_C_GUID:
+				return sizeof(SQLGUID);
+			case SQL_C_NUMERIC:
+				return sizeof(SQL_NUMERIC_STRUCT);
+			default:
+				return 0;
+			}
+		}
+	};
 };
 
 struct connection_parameter
@@ -1058,10 +1278,17 @@ public:
 	explicit database(environment& env) : odbc::base_database(env)
 	{
 	}
-	database(database&& src) : odbc::base_database(std::move(src))
+	database(database&& src) 
+		: odbc::base_database(std::move(src)), qtl::base_database<database, statement>(std::move(src))
 	{
 	}
 
+	void close()
+	{
+		clear_statement_cache();
+		odbc::base_database::close();
+	}
+
 	void open(const char* server_name, size_t server_name_length,
 		const char* user_name, size_t user_name_length, const char* password, size_t password_length)
 	{
@@ -1382,6 +1609,7 @@ public:
 			if (count > 0)
 			{
 				m_params.resize(count);
+				qtl::plan_record(*this, values);
 				qtl::bind_record(*this, std::forward<Types>(values));
 			}
 			m_binded_cols = true;
@@ -1876,12 +2104,22 @@ inline std::string base_database::create_connection_text(const connection_parame
 }
 
 inline base_statement::base_statement(base_database& db)
-	: object(db.handle()), m_blob_buffer(NULL), m_binded_cols(false)
+	: object(db.handle()), m_blob_buffer(NULL), m_binded_cols(false), m_binded_record(NULL)
 {
 }
 
 } //odbc
 
+template<>
+struct batch_executor<odbc::statement>
+{
+	template<typename Range>
+	std::vector<uint64_t> operator()(odbc::statement& command, const Range& params, size_t batch_size) const
+	{
+		return command.execute_batch(params, batch_size);
+	}
+};
+
 #ifdef _WIN32
 
 namespace mssql
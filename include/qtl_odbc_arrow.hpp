@@ -0,0 +1,231 @@
+#ifndef _QTL_ODBC_ARROW_H_
+#define _QTL_ODBC_ARROW_H_
+
+#include "qtl_odbc.hpp"
+#include "qtl_arrow.hpp"
+
+namespace qtl
+{
+
+namespace odbc
+{
+
+/*
+	Reads the rows of an executed statement into Arrow arrays.
+	Columns are typed by SQLDescribeCol, and fields are read by SQLGetData.
+	Character columns are read as SQL_C_CHAR, so the client character set should be UTF-8.
+	The statement should not have columns bound to a record.
+ */
+class arrow_reader : public qtl::arrow::basic_reader<arrow_reader>
+{
+public:
+	explicit arrow_reader(statement& stmt) : m_stmt(stmt)
+	{
+		SQLSMALLINT count = 0;
+		m_stmt.verify_error(SQLNumResultCols(m_stmt.handle(), &count));
+		for (SQLSMALLINT i = 0; i != count; i++)
+		{
+			SQLSMALLINT data_type = 0, digits = 0, nullable = SQL_NULLABLE_UNKNOWN;
+			SQLULEN size = 0;
+			SQLLEN is_unsigned = SQL_FALSE;
+			m_stmt.verify_error(SQLDescribeCol(m_stmt.handle(), i + 1, NULL, 0, NULL, &data_type, &size, &digits, &nullable));
+			m_stmt.verify_error(SQLColAttribute(m_stmt.handle(), i + 1, SQL_DESC_UNSIGNED, NULL, 0, NULL, &is_unsigned));
+			add_column(m_stmt.get_column_name(i).data(), arrow_type(data_type, is_unsigned == SQL_TRUE), nullable != SQL_NO_NULLS);
+		}
+	}
+
+	bool fetch_row()
+	{
+		SQLRETURN ret = SQLFetch(m_stmt.handle());
+		if (ret == SQL_NO_DATA)
+			return false;
+		m_stmt.verify_error(ret);
+		return true;
+	}
+
+	void read_field(size_t col, qtl::arrow::column_builder& column)
+	{
+		SQLUSMALLINT index = static_cast<SQLUSMALLINT>(col + 1);
+		switch (column.type())
+		{
+		case qtl::arrow::type::boolean:
+		{
+			unsigned char v = 0;
+			if (get_data(index, SQL_C_BIT, v))
+				column.append(v != 0);
+			else
+				column.append_null();
+			break;
+		}
+		case qtl::arrow::type::int8:
+			read_value<signed char>(index, SQL_C_STINYINT, column);
+			break;
+		case qtl::arrow::type::uint8:
+			read_value<unsigned char>(index, SQL_C_UTINYINT, column);
+			break;
+		case qtl::arrow::type::int16:
+			read_value<SQLSMALLINT>(index, SQL_C_SSHORT, column);
+			break;
+		case qtl::arrow::type::uint16:
+			read_value<SQLUSMALLINT>(index, SQL_C_USHORT, column);
+			break;
+		case qtl::arrow::type::int32:
+			read_value<SQLINTEGER>(index, SQL_C_SLONG, column);
+			break;
+		case qtl::arrow::type::uint32:
+			read_value<SQLUINTEGER>(index, SQL_C_ULONG, column);
+			break;
+		case qtl::arrow::type::int64:
+			read_value<SQLBIGINT>(index, SQL_C_SBIGINT, column);
+			break;
+		case qtl::arrow::type::uint64:
+			read_value<SQLUBIGINT>(index, SQL_C_UBIGINT, column);
+			break;
+		case qtl::arrow::type::float32:
+			read_value<SQLREAL>(index, SQL_C_FLOAT, column);
+			break;
+		case qtl::arrow::type::float64:
+			read_value<SQLDOUBLE>(index, SQL_C_DOUBLE, column);
+			break;
+		case qtl::arrow::type::date32:
+		{
+			DATE_STRUCT v;
+			if (get_data(index, SQL_C_TYPE_DATE, v))
+				column.append(qtl::arrow::days_from_civil(v.year, v.month, v.day));
+			else
+				column.append_null();
+			break;
+		}
+		case qtl::arrow::type::time64:
+		{
+			TIME_STRUCT v;
+			if (get_data(index, SQL_C_TYPE_TIME, v))
+				column.append((v.hour * INT64_C(3600) + v.minute * 60 + v.second) * 1000000);
+			else
+				column.append_null();
+			break;
+		}
+		case qtl::arrow::type::timestamp:
+		{
+			TIMESTAMP_STRUCT v;
+			if (get_data(index, SQL_C_TYPE_TIMESTAMP, v))
+			{
+				int64_t seconds = qtl::arrow::days_from_civil(v.year, v.month, v.day) * INT64_C(86400) +
+					v.hour * 3600 + v.minute * 60 + v.second;
+				column.append(seconds * 1000000 + v.fraction / 1000);
+			}
+			else
+				column.append_null();
+			break;
+		}
+		case qtl::arrow::type::binary:
+			read_data(index, SQL_C_BINARY, column);
+			break;
+		default:
+			read_data(index, SQL_C_CHAR, column);
+			break;
+		}
+	}
+
+private:
+	statement& m_stmt;
+	std::vector<char> m_buffer;
+
+	// Initial size of the buffer of variable length fields, it grows when a longer field is read.
+	enum { initial_buffer_size = 256 };
+
+	template<typename T>
+	bool get_data(SQLUSMALLINT index, SQLSMALLINT type, T& value)
+	{
+		SQLLEN indicator = 0;
+		m_stmt.verify_error(SQLGetData(m_stmt.handle(), index, type, &value, sizeof(T), &indicator));
+		return indicator != SQL_NULL_DATA;
+	}
+
+	template<typename T>
+	void read_value(SQLUSMALLINT index, SQLSMALLINT type, qtl::arrow::column_builder& column)
+	{
+		T value = 0;
+		if (get_data(index, type, value))
+			column.append(value);
+		else
+			column.append_null();
+	}
+
+	// Reads a long field in parts, the buffer is enlarged until the field fits in it.
+	void read_data(SQLUSMALLINT index, SQLSMALLINT type, qtl::arrow::column_builder& column)
+	{
+		// each part of character data is terminated by a null character
+		const size_t terminator = type == SQL_C_CHAR ? 1 : 0;
+		size_t size = 0;
+		if (m_buffer.size() < initial_buffer_size)
+			m_buffer.resize(initial_buffer_size);
+		for (;;)
+		{
+			SQLLEN indicator = 0;
+			SQLRETURN ret = SQLGetData(m_stmt.handle(), index, type, &m_buffer[size],
+				static_cast<SQLLEN>(m_buffer.size() - size), &indicator);
+			if (ret == SQL_NO_DATA)
+				break;
+			m_stmt.verify_error(ret);
+			if (indicator == SQL_NULL_DATA)
+			{
+				column.append_null();
+				return;
+			}
+			size_t available = m_buffer.size() - size - terminator;
+			if (indicator != SQL_NO_TOTAL && static_cast<size_t>(indicator) <= available)
+			{
+				size += indicator;
+				break;
+			}
+			size += available;
+			size_t remaining = indicator == SQL_NO_TOTAL ? m_buffer.size() : indicator - available;
+			m_buffer.resize(size + remaining + terminator);
+		}
+		column.append(m_buffer.data(), size);
+	}
+
+	static qtl::arrow::type arrow_type(SQLSMALLINT data_type, bool is_unsigned)
+	{
+		switch (data_type)
+		{
+		case SQL_BIT:
+			return qtl::arrow::type::boolean;
+		case SQL_TINYINT:
+			return is_unsigned ? qtl::arrow::type::uint8 : qtl::arrow::type::int8;
+		case SQL_SMALLINT:
+			return is_unsigned ? qtl::arrow::type::uint16 : qtl::arrow::type::int16;
+		case SQL_INTEGER:
+			return is_unsigned ? qtl::arrow::type::uint32 : qtl::arrow::type::int32;
+		case SQL_BIGINT:
+			return is_unsigned ? qtl::arrow::type::uint64 : qtl::arrow::type::int64;
+		case SQL_REAL:
+			return qtl::arrow::type::float32;
+		case SQL_FLOAT:
+		case SQL_DOUBLE:
+			return qtl::arrow::type::float64;
+		case SQL_TYPE_DATE:
+		case SQL_DATE:
+			return qtl::arrow::type::date32;
+		case SQL_TYPE_TIME:
+		case SQL_TIME:
+			return qtl::arrow::type::time64;
+		case SQL_TYPE_TIMESTAMP:
+		case SQL_TIMESTAMP:
+			return qtl::arrow::type::timestamp;
+		case SQL_BINARY:
+		case SQL_VARBINARY:
+		case SQL_LONGVARBINARY:
+			return qtl::arrow::type::binary;
+		default:
+			return qtl::arrow::type::utf8;
+		}
+	}
+};
+
+}
+
+}
+
+#endif //_QTL_ODBC_ARROW_H_
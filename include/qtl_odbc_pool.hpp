@@ -49,6 +49,12 @@ public:
 	async_pool(EventLoop& ev) : base_class(ev) { }
 	virtual ~async_pool() { }
 
+	// Requests still waiting for connections fail with it when the pool is destroyed.
+	static typename base_class::exception_type closed_error()
+	{
+		return odbc::error(SQL_ERROR, "the connection pool is destroyed");
+	}
+
 	template<typename Handler>
 	void new_connection(EventLoop& ev, Handler&& handler) throw()
 	{
@@ -8,6 +8,7 @@
 
 #ifdef _QTL_ENABLE_CPP17
 
+#include <array>
 #include <boost/pfr.hpp>
 
 namespace qtl
@@ -155,11 +156,11 @@ namespace qtl
 		template<class T, typename Matcher, typename = typename std::enable_if<std::is_class<T>::value>::type>
 		struct auto_bind_t
 		{
-			auto_bind_t(Matcher matcher) : _record(*new(_defvalue)T()), _matcher(matcher) { }
-			explicit auto_bind_t(T& value, Matcher matcher) : _record(value), _matcher(matcher) { }
+			auto_bind_t(Matcher matcher) : _record(*new(_defvalue)T()), _matcher(matcher), _planned(false) { }
+			explicit auto_bind_t(T& value, Matcher matcher) : _record(value), _matcher(matcher), _planned(false) { }
 			template<typename... Args>
 			explicit auto_bind_t(Matcher matcher, Args&&... args)
-				: _record(*new(_defvalue) T(std::forward<Args>(args)...)), _matcher(matcher)
+				: _record(*new(_defvalue) T(std::forward<Args>(args)...)), _matcher(matcher), _planned(false)
 			{
 			}
 			~auto_bind_t()
@@ -167,28 +168,50 @@ namespace qtl
 				detail::destroy_trivially(&_record, reinterpret_cast<T*>(_defvalue));
 			}
 
+			// Matches members to columns by name, the result is used by all rows of the result set.
+			template<typename Command>
+			void plan(Command& command)
+			{
+				_columns.fill(npos);
+				const size_t count = command.get_column_count();
+				for (size_t i = 0; i != count; i++)
+					this->plan_field<boost::pfr::tuple_size<T>::value - 1>(i, command.get_column_name(i));
+				_planned = true;
+			}
+
 			template<typename Command>
 			void bind(Command& command)
 			{
+				if (!_planned)
+					plan(command);
 				this->bind_field<Command, boost::pfr::tuple_size<T>::value - 1>(command);
 			}
 
 			operator T& () { return _record; }
 
 		private:
+			static constexpr size_t npos = static_cast<size_t>(-1);
 			char _defvalue[sizeof(T)];
 			T& _record;
 			Matcher _matcher;
+			std::array<size_t, boost::pfr::tuple_size<T>::value> _columns; // column of each member, npos if no column matches
+			bool _planned;
+
+			template<size_t No>
+			void plan_field(size_t column, const char* name)
+			{
+				if (_matcher(boost::pfr::get_name<No, T>(), name))
+					_columns[No] = column;
+
+				if constexpr (No > 0)
+					this->plan_field<No - 1>(column, name);
+			}
 
 			template<typename Command, size_t No>
 			void bind_field(Command& command)
 			{
-				size_t count = command.get_column_count();
-				for (size_t i = 0; i != count; i++)
-				{
-					if (_matcher(boost::pfr::get_name<No, T>(), command.get_column_name(i)))
-						qtl::bind_field(command, i, boost::pfr::get<No>(_record));
-				}
+				if (_columns[No] != npos)
+					qtl::bind_field(command, _columns[No], boost::pfr::get<No>(_record));
 
 				if constexpr (No > 0)
 					this->bind_field<Command, No - 1>(command);
@@ -224,6 +247,15 @@ namespace qtl
 		}
 	};
 
+	template<typename Command, typename T, typename Matcher>
+	struct record_planner<Command, pfr::auto_bind_t<T, Matcher>>
+	{
+		void operator()(Command& command, pfr::auto_bind_t<T, Matcher>& record) const
+		{
+			record.plan(command);
+		}
+	};
+
 #endif
 
 }
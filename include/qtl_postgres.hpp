@@ -7,9 +7,12 @@
 #include <map>
 #include <vector>
 #include <array>
+#include <deque>
+#include <functional>
 #include <exception>
 #include <sstream>
 #include <chrono>
+#include <atomic>
 #include <algorithm>
 #include <assert.h>
 #include "qtl_common.hpp"
@@ -783,6 +786,25 @@ struct base_object_traits
 template<typename T>
 struct object_traits;
 
+namespace detail
+{
+	/*
+		Appends the length and the value to the buffer.
+		Values which are encoded into the buffer are written in place, others are copied.
+	 */
+	template<typename T>
+	inline void push_value(std::vector<char>& buffer, const T& v)
+	{
+		size_t n = buffer.size() + sizeof(int32_t);
+		buffer.resize(n);
+		std::pair<const char*, size_t> blob = object_traits<T>::data(v, buffer);
+		if (buffer.size() == n)
+			buffer.insert(buffer.end(), blob.first, blob.first + blob.second);
+		int32_t length = hton(static_cast<int32_t>(blob.second));
+		memcpy(buffer.data() + n - sizeof(int32_t), &length, sizeof(int32_t));
+	}
+}
+
 #define QTL_POSTGRES_SIMPLE_TRAITS(T, oid, array_oid) \
 template<> struct object_traits<T> : public base_object_traits<T, oid> { \
 	enum { array_type_id = array_oid }; \
@@ -1061,13 +1083,8 @@ struct vector_traits : public base_object_traits<std::vector<T>, id>
 		header->dims[0].length = detail::hton(static_cast<int32_t>(v.size()));
 		header->dims[0].lower_bound = detail::hton(1);
 
-		std::vector<char> temp;
 		for (const T& e : v)
-		{
-			std::pair<const char*, size_t> blob = object_traits<T>::data(e, temp);
-			detail::push(buffer, static_cast<int32_t>(blob.second));
-			buffer.insert(buffer.end(), blob.first, blob.first + blob.second);
-		}
+			detail::push_value(buffer, e);
 		return std::make_pair(buffer.data()+n, buffer.size()-n);
 	}
 };
@@ -1118,13 +1135,8 @@ struct iterator_traits : public base_object_traits<Iterator, id>
 		header->dims[0].length = detail::hton(static_cast<int32_t>(std::distance(first, last)));
 		header->dims[0].lower_bound = detail::hton(1);
 
-		std::vector<char> temp;
 		for (Iterator it=first; it!=last; it++)
-		{
-			std::pair<const char*, size_t> blob = object_traits<typename std::iterator_traits<Iterator>::value_type>::data(*it, temp);
-			detail::push(buffer, static_cast<int32_t>(blob.second));
-			buffer.insert(buffer.end(), blob.first, blob.first + blob.second);
-		}
+			detail::push_value(buffer, *it);
 		return std::make_pair(buffer.data() + n, buffer.size() - n);
 	}
 };
@@ -1239,11 +1251,8 @@ namespace detail
 	template<typename Type>
 	static void push_field(const Type& field, std::vector<char>& buffer)
 	{
-		std::vector<char> temp;
 		detail::push(buffer, static_cast<int32_t>(object_traits<Type>::type_id));
-		auto result = object_traits<Type>::data(field, temp);
-		detail::push(buffer, static_cast<int32_t>(result.second));
-		buffer.insert(buffer.end(), result.first, result.first + result.second);
+		detail::push_value(buffer, field);
 	}
 
 	template<typename Tuple, size_t N>
@@ -1329,6 +1338,7 @@ struct binder
 		m_type = oid;
 		m_value = data;
 		m_length = n;
+		m_offset = npos;
 	}
 
 	Oid constexpr type() const { return m_type; }
@@ -1338,8 +1348,7 @@ struct binder
 	template<typename T>
 	T get()
 	{
-		if (!object_traits<T>::is_match(m_type))
-			throw std::bad_cast();
+		check_type<T>();
 
 		T v;
 		object_traits<T>::get(v, m_value, m_value + m_length);
@@ -1348,16 +1357,15 @@ struct binder
 	template<typename T>
 	T get(PGconn* conn)
 	{
-		if (!object_traits<T>::is_match(m_type))
-			throw std::bad_cast();
+		check_type<T>();
 
 		return object_traits<T>::get(conn, m_value, m_value + m_length);
 	}
 	template<typename T>
 	void get(T& v)
 	{
-		if (object_traits<T>::type_id!= InvalidOid && !object_traits<T>::is_match(m_type))
-			throw std::bad_cast();
+		if (object_traits<T>::type_id != InvalidOid)
+			check_type<T>();
 
 		object_traits<T>::get(v, m_value, m_value + m_length);
 	}
@@ -1366,45 +1374,86 @@ struct binder
 	{
 		m_value = nullptr;
 		m_length = 0;
+		m_offset = npos;
 	}
 	void bind(qtl::null)
 	{
 		bind(nullptr);
 	}
+	void bind(std::nullptr_t, std::vector<char>& /*arena*/)
+	{
+		bind(nullptr);
+	}
+	void bind(qtl::null, std::vector<char>& /*arena*/)
+	{
+		bind(nullptr);
+	}
 
+	/*
+		Values which need encoding are appended to the arena of the statement.
+		The arena may move while later parameters are encoded, so call locate before sending them.
+	 */
 	template<typename T, typename = typename std::enable_if<!std::is_array<T>::value>::type>
-	void bind(const T& v)
+	void bind(const T& v, std::vector<char>& arena)
 	{
 		typedef typename std::decay<T>::type param_type;
 		if (m_type!=0 && !object_traits<param_type>::is_match(m_type))
 			throw std::bad_cast();
 
-		auto pair = object_traits<param_type>::data(v, m_data);
-		m_value = pair.first;
-		m_length = pair.second;
+		size_t n = arena.size();
+		assign(object_traits<param_type>::data(v, arena), arena, n);
 	}
 	void bind(const char* data, size_t length=0)
 	{
 		m_value = data;
 		if(length>0) m_length = length;
 		else m_length = strlen(data);
+		m_offset = npos;
 	}
 	template<typename T, size_t N>
-	void bind(const T(&v)[N])
+	void bind(const T(&v)[N], std::vector<char>& arena)
 	{
 		if (m_type != 0 && !object_traits<T(&)[N]>::is_match(m_type))
 			throw std::bad_cast();
 
-		auto pair = object_traits<T(&)[N]>::data(v, m_data);
-		m_value = pair.first;
-		m_length = pair.second;
+		size_t n = arena.size();
+		assign(object_traits<T(&)[N]>::data(v, arena), arena, n);
+	}
+
+	void locate(const std::vector<char>& arena)
+	{
+		if (m_offset != npos)
+			m_value = arena.data() + m_offset;
 	}
 
 private:
 	Oid m_type;
 	const char* m_value;
 	size_t m_length;
-	std::vector<char> m_data;
+	size_t m_offset; // position of the value in the arena, or npos if it is not there
+	static const size_t npos = static_cast<size_t>(-1);
+
+	void assign(const std::pair<const char*, size_t>& data, const std::vector<char>& arena, size_t n)
+	{
+		m_value = data.first;
+		m_length = data.second;
+		m_offset = arena.size() != n ? static_cast<size_t>(data.first - arena.data()) : npos;
+	}
+
+	template<typename T>
+	void check_type() const
+	{
+		if (m_type == InvalidOid)
+		{
+			// binary copy data has no types, only the size of a fixed size value can be checked
+			if (std::is_arithmetic<T>::value && m_length != sizeof(T))
+				throw std::bad_cast();
+		}
+		else if (!object_traits<T>::is_match(m_type))
+		{
+			throw std::bad_cast();
+		}
+	}
 };
 
 template<size_t N, size_t I, typename Arg, typename... Other>
@@ -1570,6 +1619,185 @@ private:
 	PGresult* m_res;
 };
 
+/*
+	How the rows of a query are received:
+	single_row receives a result for each row, it keeps memory bounded and is the default.
+	chunked receives results of at most chunk size rows, it needs libpq 17 or later and works as single_row before.
+	buffered receives all rows in one result, it is the fastest for small and medium results.
+ */
+enum class fetch_mode
+{
+	single_row,
+	chunked,
+	buffered
+};
+
+/*
+	Statements prepared on a connection, keyed by query text and parameter types, in LRU order.
+	Statements evicted from the registry are deallocated in batches, after no statement object uses them.
+ */
+class statement_registry
+{
+public:
+	typedef std::shared_ptr<const std::string> name_type;
+	enum { deallocation_batch = 16 };
+
+	enum { max_counted = 1024 };
+
+	statement_registry() : m_capacity(128), m_threshold(1), m_unnamed(false) { }
+	statement_registry(const statement_registry&) = delete;
+	statement_registry& operator=(const statement_registry&) = delete;
+
+	size_t capacity() const { return m_capacity; }
+	void set_capacity(size_t capacity)
+	{
+		m_capacity = capacity;
+		shrink();
+	}
+	bool unnamed() const { return m_unnamed; }
+	void set_unnamed(bool unnamed) { m_unnamed = unnamed; }
+	size_t size() const { return m_entries.size(); }
+	size_t pending_deallocations() const { return m_evicted.size(); }
+
+	unsigned prepare_threshold() const { return m_threshold; }
+	void set_prepare_threshold(unsigned threshold)
+	{
+		m_threshold = threshold;
+		m_uses.clear();
+	}
+
+	// Counts the opening of a query which is not prepared, returns true when it should be prepared.
+	bool should_prepare(const char* query_text, int count, const Oid* types)
+	{
+		if (m_threshold <= 1)
+			return m_threshold == 1;
+		// counts of ad-hoc queries are forgotten rather than growing without bound
+		if (m_uses.size() >= max_counted)
+			m_uses.clear();
+		std::string key = make_key(query_text, count, types);
+		unsigned& uses = m_uses[key];
+		if (++uses < m_threshold)
+			return false;
+		m_uses.erase(key);
+		return true;
+	}
+
+	static std::string make_key(const char* query_text, int count, const Oid* types)
+	{
+		std::string key(query_text);
+		key.push_back('\0');
+		if (count > 0 && types)
+			key.append(reinterpret_cast<const char*>(types), count * sizeof(Oid));
+		return key;
+	}
+
+	// statements may be moved after preparing, so their address is not an unique name
+	static std::string make_name()
+	{
+		static std::atomic<unsigned long long> serial(0);
+		char name[sizeof(unsigned long long) * 3 + 2];
+		int n = sprintf(name, "q%llu", ++serial);
+		return std::string(name, n);
+	}
+
+	name_type find(const std::string& key)
+	{
+		auto it = m_index.find(key);
+		if (it == m_index.end())
+			return name_type();
+		m_entries.splice(m_entries.begin(), m_entries, it->second);
+		return it->second->name;
+	}
+
+	name_type insert(std::string&& key, std::string&& name)
+	{
+		name_type result = std::make_shared<const std::string>(std::move(name));
+		m_entries.emplace_front(std::move(key), result);
+		m_index.emplace(m_entries.front().key, m_entries.begin());
+		shrink();
+		return result;
+	}
+
+	// Forgets a statement which failed to be prepared.
+	void remove(const std::string& key, const name_type& name)
+	{
+		auto it = m_index.find(key);
+		if (it != m_index.end() && it->second->name == name)
+		{
+			m_entries.erase(it->second);
+			m_index.erase(it);
+		}
+	}
+
+	// Returns the query deallocating evicted statements which are not used any more, and forgets them.
+	std::string take_deallocations()
+	{
+		std::string query_text;
+		auto it = m_evicted.begin();
+		while (it != m_evicted.end())
+		{
+			if (it->use_count() == 1)
+			{
+				query_text += "DEALLOCATE ";
+				query_text += **it;
+				query_text += ';';
+				it = m_evicted.erase(it);
+			}
+			else
+			{
+				++it;
+			}
+		}
+		return query_text;
+	}
+
+	// Deallocates evicted statements, it waits for a transaction in error state to finish.
+	void flush(PGconn* conn)
+	{
+		PGTransactionStatusType status = PQtransactionStatus(conn);
+		if (status != PQTRANS_IDLE && status != PQTRANS_INTRANS)
+			return;
+		std::string query_text = take_deallocations();
+		if (!query_text.empty())
+			PQclear(PQexec(conn, query_text.data()));
+	}
+
+	// Statements of a connection are gone after it is closed or reset.
+	void clear()
+	{
+		m_index.clear();
+		m_entries.clear();
+		m_evicted.clear();
+		m_uses.clear();
+	}
+
+private:
+	struct entry
+	{
+		std::string key;
+		name_type name;
+
+		entry(std::string&& key, const name_type& name) : key(std::move(key)), name(name) { }
+	};
+	std::list<entry> m_entries; // most recently used first
+	std::unordered_map<std::string, typename std::list<entry>::iterator> m_index;
+	std::vector<name_type> m_evicted;
+	std::unordered_map<std::string, unsigned> m_uses; // openings of queries not prepared yet
+	size_t m_capacity;
+	unsigned m_threshold;
+	bool m_unnamed;
+
+	void shrink()
+	{
+		while (m_entries.size() > m_capacity)
+		{
+			m_evicted.push_back(m_entries.back().name);
+			m_index.erase(m_entries.back().key);
+			m_entries.pop_back();
+		}
+	}
+};
+
 class base_statement
 {
 	friend class error;
@@ -1580,8 +1808,12 @@ public:
 	 }
 	 base_statement(const base_statement&) = delete;
 	 base_statement(base_statement&& src) 
-		 : m_conn(src.m_conn), m_binders(std::move(src.m_binders)), m_res(std::move(src.m_res)), _name(std::move(src._name))
+		 : m_conn(src.m_conn), m_registry(src.m_registry), m_binders(std::move(src.m_binders)), m_res(std::move(src.m_res)), m_row(src.m_row), m_bound_record(src.m_bound_record),
+		 m_fetch_mode(src.m_fetch_mode), m_chunk_size(src.m_chunk_size),
+		 _name(std::move(src._name)), m_prepared(std::move(src.m_prepared)),
+		 m_command(std::move(src.m_command)), m_types(std::move(src.m_types)), m_arena(std::move(src.m_arena))
 	 {
+		 src._name.clear();
 	 }
 	 base_statement& operator=(const base_statement&) = delete;
 	 base_statement& operator=(base_statement&& src)
@@ -1590,14 +1822,33 @@ public:
 		 {
 			 close();
 			 m_conn = src.m_conn;
+			 m_registry = src.m_registry;
 			 m_binders = std::move(src.m_binders);
 			 m_res = std::move(src.m_res);
+			 m_row = src.m_row;
+			 m_bound_record = src.m_bound_record;
+			 m_fetch_mode = src.m_fetch_mode;
+			 m_chunk_size = src.m_chunk_size;
+			 _name = std::move(src._name);
+			 m_prepared = std::move(src.m_prepared);
+			 m_command = std::move(src.m_command);
+			 m_types = std::move(src.m_types);
+			 m_arena = std::move(src.m_arena);
+			 src._name.clear();
 		 }
 		 return *this;
 	 }
 
 	result& get_result() { return m_res; }
 
+	// Sets how the rows of following executions are received, chunk_size is used by fetch_mode::chunked.
+	void set_fetch_mode(postgres::fetch_mode mode, int chunk_size = 256)
+	{
+		m_fetch_mode = mode;
+		m_chunk_size = chunk_size > 0 ? chunk_size : 1;
+	}
+	postgres::fetch_mode fetch_mode() const { return m_fetch_mode; }
+
 	void close()
 	{
 		m_res = nullptr;
@@ -1631,13 +1882,13 @@ public:
 	template<class Param>
 	void bind_param(size_t index, const Param& param)
 	{
-		m_binders[index].bind(param);
+		m_binders[index].bind(param, m_arena);
 	}
 
 	template<class Type>
 	void bind_field(size_t index, Type&& value)
 	{
-		if (m_res.is_null(0, static_cast<int>(index)))
+		if (is_null(index))
 			value = Type();
 		else
 			value = m_binders[index].get<typename std::remove_const<Type>::type>();
@@ -1645,7 +1896,8 @@ public:
 
 	void bind_field(size_t index, char* value, size_t length)
 	{
-		memcpy(value, m_binders[index].value(), std::min<size_t>(length, m_binders[index].length()));
+		if (!is_null(index))
+			memcpy(value, m_binders[index].value(), std::min<size_t>(length, m_binders[index].length()));
 	}
 
 	template<size_t N>
@@ -1657,31 +1909,31 @@ public:
 	template<typename T>
 	void bind_field(size_t index, bind_string_helper<T>&& value)
 	{
-		value.assign(m_binders[index].value(), m_binders[index].length());
+		if (is_null(index))
+			value.clear();
+		else
+			value.assign(m_binders[index].value(), m_binders[index].length());
 	}
 
 	template<typename Type>
 	void bind_field(size_t index, indicator<Type>&& value)
 	{
-		if (m_res)
-		{
-			qtl::bind_field(*this, index, value.data);
-			value.is_null = m_res.is_null(0, static_cast<int>(index));
-			value.length = m_res.length(0, static_cast<int>(index));
-			value.is_truncated = m_binders[index].length() < value.length;
-		}
+		qtl::bind_field(*this, index, value.data);
+		value.is_null = is_null(index);
+		value.length = m_binders[index].length();
+		value.is_truncated = false;
 	}
 
 	void bind_field(size_t index, large_object&& value)
 	{
-		if (m_res.is_null(0, static_cast<int>(index)))
+		if (is_null(index))
 			value.close();
 		else
 			value = m_binders[index].get<large_object>(m_conn);
 	}
 	void bind_field(size_t index, blob_data&& value)
 	{
-		if (m_res.is_null(0, static_cast<int>(index)))
+		if (is_null(index))
 		{
 			value.data = nullptr;
 			value.size = 0;
@@ -1695,7 +1947,7 @@ public:
 	template<typename... Types>
 	void bind_field(size_t index, std::tuple<Types...>&& value)
 	{
-		if (m_res.is_null(0, static_cast<int>(index)))
+		if (is_null(index))
 			value = std::tuple<Types...>();
 		else
 			m_binders[index].get(value);
@@ -1706,7 +1958,7 @@ public:
 	template<typename T>
 	inline void bind_field(size_t index, std::optional<T>&& value)
 	{
-		if (m_res.is_null(0, static_cast<int>(index)))
+		if (is_null(index))
 		{
 			value.reset();
 		}
@@ -1720,13 +1972,13 @@ public:
 
 	void bind_field(size_t index, std::any&& value)
 	{
-		if (m_res.is_null(0, static_cast<int>(index)))
+		if (is_null(index))
 		{
 			value = nullptr;
 		}
 		else
 		{
-			Oid oid = m_res.get_column_type(index);
+			Oid oid = m_binders[index].type();
 			switch (oid)
 			{
 			case object_traits<bool>::type_id:
@@ -1812,11 +2064,113 @@ public:
 
 #endif // C++17
 
+	// Rows of a partial result are followed by more results of the query.
+	static bool is_partial(ExecStatusType status)
+	{
+#ifdef LIBPQ_HAS_CHUNK_MODE
+		if (status == PGRES_TUPLES_CHUNK)
+			return true;
+#endif //LIBPQ_HAS_CHUNK_MODE
+		return status == PGRES_SINGLE_TUPLE;
+	}
+
 protected:
 	PGconn* m_conn;
+	statement_registry* m_registry;
 	result m_res;
+	int m_row; // row of the result which fields are bound from
+	const void* m_bound_record; // record which columns of the result set are planned for
+	postgres::fetch_mode m_fetch_mode;
+	int m_chunk_size;
 	std::string _name;
+	// set if the statement is kept by the registry, which deallocates it
+	statement_registry::name_type m_prepared;
+	// query text and parameter types of a statement which is not prepared
+	std::string m_command;
+	std::vector<Oid> m_types;
 	std::vector<binder> m_binders;
+	// parameters are encoded here, it keeps its capacity so executions do not allocate
+	std::vector<char> m_arena;
+	std::vector<const char*> m_values;
+	std::vector<int> m_lengths;
+	std::vector<int> m_formats;
+
+	void reset_params(size_t count)
+	{
+		m_binders.resize(count);
+		m_arena.clear();
+	}
+	void locate_params()
+	{
+		for (binder& param : m_binders)
+			param.locate(m_arena);
+	}
+	// Builds the arrays of parameters passed to libpq.
+	void collect_params()
+	{
+		locate_params();
+		size_t count = m_binders.size();
+		m_values.resize(count);
+		m_lengths.resize(count);
+		m_formats.resize(count, 1);
+		for (size_t i = 0; i != count; i++)
+		{
+			m_values[i] = m_binders[i].value();
+			m_lengths[i] = static_cast<int>(m_binders[i].length());
+		}
+	}
+	// libpq copies the parameters when they are sent, so the arena is reused by the next execution.
+	int send_params()
+	{
+		int ok;
+		if (m_binders.empty())
+		{
+			ok = send_query(0, nullptr, nullptr, nullptr);
+		}
+		else
+		{
+			collect_params();
+			ok = send_query(static_cast<int>(m_binders.size()), m_values.data(), m_lengths.data(), m_formats.data());
+		}
+		m_arena.clear();
+		return ok;
+	}
+
+	/*
+		Leaves the query unprepared if it has been opened fewer times than the prepare threshold of the connection,
+		then it is sent with its parameters by PQsendQueryParams, in one round trip.
+	 */
+	bool open_direct(const char* command, int nParams, const Oid* paramTypes)
+	{
+		if (m_registry == nullptr || m_registry->should_prepare(command, nParams, paramTypes))
+			return false;
+		_name.clear();
+		m_prepared = nullptr;
+		m_command.assign(command);
+		if (paramTypes)
+			m_types.assign(paramTypes, paramTypes + nParams);
+		return true;
+	}
+	int send_query(int count, const char* const* values, const int* lengths, const int* formats)
+	{
+		if (m_command.empty())
+			return PQsendQueryPrepared(m_conn, _name.data(), count, values, lengths, formats, 1);
+		const Oid* types = m_types.size() == static_cast<size_t>(count) ? m_types.data() : nullptr;
+		return PQsendQueryParams(m_conn, m_command.data(), count, types, values, lengths, formats, 1);
+	}
+
+	// Returns true if the statement has been prepared on this connection.
+	bool find_prepared(const std::string& key)
+	{
+		m_prepared = m_registry->find(key);
+		if (m_prepared)
+			_name = *m_prepared;
+		return m_prepared != nullptr;
+	}
+	bool use_registry() const
+	{
+		return m_registry && m_registry->capacity() > 0;
+	}
 
 	template<ExecStatusType... Excepted>
 	void verify_error()
@@ -1841,6 +2195,69 @@ protected:
 		m_binders[index].get(v);
 		return v;
 	}
+
+	// Sets how the rows of the query just sent are received.
+	bool set_row_mode()
+	{
+		switch (m_fetch_mode)
+		{
+		case postgres::fetch_mode::buffered:
+			return true;
+#ifdef LIBPQ_HAS_CHUNK_MODE
+		case postgres::fetch_mode::chunked:
+			return PQsetChunkedRowsMode(m_conn, m_chunk_size) != 0;
+#endif //LIBPQ_HAS_CHUNK_MODE
+		default:
+			return PQsetSingleRowMode(m_conn) != 0;
+		}
+	}
+
+	// Verifies the first result of an execution.
+	void verify_execute(error& e)
+	{
+		m_row = 0;
+		m_bound_record = nullptr;
+		if (!m_res)
+			e = error(m_conn);
+		else if (!is_partial(m_res.status()))
+			m_res.verify_error<PGRES_COMMAND_OK, PGRES_TUPLES_OK>(e);
+	}
+
+	// Binds the fields of a row, a null field is bound to nullptr.
+	void bind_row(int row)
+	{
+		int count = m_res.get_column_count();
+		m_binders.resize(count);
+		for (int i = 0; i != count; i++)
+		{
+			const char* value = m_res.is_null(row, i) ? nullptr : m_res.get_value(row, i);
+			m_binders[i] = binder(value, m_res.length(row, i), m_res.get_column_type(i));
+		}
+		m_row = row;
+	}
+	bool is_null(size_t index) const
+	{
+		return m_binders[index].value() == nullptr;
+	}
+
+	// Calls proc with each row of a whole result.
+	template<typename Command, typename ValueProc>
+	void fetch_rows(Command& command, ValueProc& proc)
+	{
+		int row_count = PQntuples(m_res.handle());
+		if (row_count > 0)
+		{
+			auto values = qtl::detail::make_values(proc);
+			qtl::plan_record(command, values);
+			for (int i = 0; i != row_count; i++)
+			{
+				bind_row(i);
+				qtl::bind_record(command, std::forward<decltype(values)>(values));
+				qtl::detail::apply(proc, std::forward<decltype(values)>(values));
+			}
+			m_row = 0;
+		}
+	}
 };
 
 class statement : public base_statement
@@ -1858,7 +2275,7 @@ public:
 	{
 		finish(m_res);
 
-		if (!_name.empty())
+		if (!_name.empty() && !m_prepared)
 		{
 			std::ostringstream oss;
 			oss << "DEALLOCATE " << _name << ";";
@@ -1867,14 +2284,55 @@ public:
 		}
 	}
 
+	/*
+		A statement prepared before with the same text and parameter types is reused from the registry of the connection.
+		With unnamed statements, it is replaced by the next statement opened on the connection.
+		Below the prepare threshold of the connection, it is not prepared but executed in one round trip.
+	 */
 	void open(const char* command, int nParams=0, const Oid *paramTypes=nullptr)
 	{
-		_name.resize(sizeof(intptr_t) * 2+1);
-		int n = sprintf(const_cast<char*>(_name.data()), "q%p", this);
-		_name.resize(n);
-		std::transform(_name.begin(), _name.end(), _name.begin(), tolower);
+		std::string key;
+		m_command.clear();
+		m_types.clear();
+		if (use_registry() && !m_registry->unnamed())
+		{
+			key = statement_registry::make_key(command, nParams, paramTypes);
+			if (find_prepared(key))
+				return;
+		}
+		if (open_direct(command, nParams, paramTypes))
+			return;
+		if (m_registry && m_registry->unnamed())
+		{
+			_name.clear();
+		}
+		else if (!key.empty())
+		{
+			if (m_registry->pending_deallocations() >= statement_registry::deallocation_batch)
+				m_registry->flush(m_conn);
+			_name = statement_registry::make_name();
+		}
+		else
+		{
+			_name = statement_registry::make_name();
+		}
 		result res = PQprepare(m_conn, _name.data(), command, nParams, paramTypes);
-		res.verify_error<PGRES_COMMAND_OK>();
+		if (!_name.empty())
+		{
+			error e;
+			res.verify_error<PGRES_COMMAND_OK>(e);
+			if (e)
+			{
+				_name.clear();
+				throw e;
+			}
+		}
+		else
+		{
+			res.verify_error<PGRES_COMMAND_OK>();
+		}
+		if (!key.empty())
+			m_prepared = m_registry->insert(std::move(key), std::string(_name));
 	}
 	template<typename... Types>
 	void open(const char* command)
@@ -1893,118 +2351,190 @@ public:
 		result res = PQdescribePrepared(m_conn, name);
 		res.verify_error<PGRES_COMMAND_OK>();
 		_name = name;
+		m_prepared = nullptr;
+		m_command.clear();
+		m_types.clear();
 	}
 
 	void execute()
 	{
-		if (m_binders.size())
-		{
-			std::vector<const char*> values(m_binders.size());
-			std::vector<int> lengths(m_binders.size());
-			std::vector<int> formats(m_binders.size());
-
-			for (size_t i = 0; i < m_binders.size(); i++)
-			{
-				values[i] = m_binders[i].value();
-				lengths[i] = static_cast<int>(m_binders[i].length());
-				formats[i] = 1;
-			}
-
-			if (!PGSQL::PQsendQueryPrepared(m_conn, _name.data(),
-				(int)m_binders.size(), values.data(), lengths.data(), formats.data(), 1))
-				throw error(m_conn);
-		}
-		else
-		{
-			if (!PGSQL::PQsendQueryPrepared(m_conn, _name.data(), 0, nullptr, nullptr, nullptr, 1))
-				throw error(m_conn);
-		}
+		if (!send_params())
+			throw error(m_conn);
 
-		if (!PGSQL::PQsetSingleRowMode(m_conn))
+		if (!set_row_mode())
 			throw error(m_conn);
-		m_res = PGSQL::PQgetResult(m_conn);
-		verify_error<PGSQL::PGRES_COMMAND_OK, PGSQL::PGRES_SINGLE_TUPLE>();
+		m_res = PQgetResult(m_conn);
+		error e;
+		verify_execute(e);
+		if (e) throw e;
 	}
 
 	template<typename Types>
 	void execute(const Types& params)
 	{
-		const size_t count = qtl::params_binder<statement, Types>::size;
-		if (count > 0)
-		{
-			m_binders.resize(count);
-			qtl::bind_params(*this, params);
+		send_prepared(params);
+		if (!set_row_mode())
+			throw error(m_conn);
+		m_res = PQgetResult(m_conn);
+		error e;
+		verify_execute(e);
+		if (e) throw e;
+	}
 
-			std::array<const char*, count> values;
-			std::array<int, count> lengths;
-			std::array<int, count> formats;
-			for (size_t i = 0; i != m_binders.size(); i++)
+	/*
+		With libpq 14 or later, each batch is sent in one round trip in pipeline mode.
+	 */
+	template<typename Range>
+	std::vector<uint64_t> execute_batch(const Range& params, size_t batch_size)
+	{
+		std::vector<uint64_t> affected;
+		auto it = std::begin(params);
+		auto last = std::end(params);
+#ifdef LIBPQ_HAS_PIPELINING
+		if (!PQenterPipelineMode(m_conn))
+			throw error(m_conn);
+		bool unsynced = false; // queries are sent without a following sync
+		size_t pending_syncs = 0; // syncs sent but not received
+		try
+		{
+			while (it != last)
 			{
-				values[i] = m_binders[i].value();
-				lengths[i] = static_cast<int>(m_binders[i].length());
-				formats[i] = 1;
+				size_t rows = 0;
+				unsynced = true;
+				for (; rows != batch_size && it != last; ++rows, ++it)
+					send_prepared(*it);
+				if (!PQpipelineSync(m_conn))
+					throw error(m_conn);
+				unsynced = false;
+				++pending_syncs;
+				uint64_t count = 0;
+				for (size_t i = 0; i != rows; i++)
+				{
+					m_res = PQgetResult(m_conn);
+					verify_error<PGRES_COMMAND_OK, PGRES_TUPLES_OK>();
+					count += m_res.affected_rows();
+					finish(m_res);
+				}
+				m_res = PQgetResult(m_conn);
+				if (m_res && m_res.status() == PGRES_PIPELINE_SYNC)
+					--pending_syncs;
+				verify_error<PGRES_PIPELINE_SYNC>();
+				m_res = nullptr;
+				affected.push_back(count);
 			}
-			if (!PQsendQueryPrepared(m_conn, _name.data(), static_cast<int>(m_binders.size()), values.data(), lengths.data(), formats.data(), 1))
-				throw error(m_conn);
 		}
-		else
+		catch (...)
 		{
-			if (!PQsendQueryPrepared(m_conn, _name.data(), 0, nullptr, nullptr, nullptr, 1))
+			// discard the rest of the batch
+			m_res = nullptr;
+			if (unsynced && PQpipelineSync(m_conn))
+				++pending_syncs;
+			while (pending_syncs > 0 && PQstatus(m_conn) == CONNECTION_OK)
+			{
+				result res = PQgetResult(m_conn);
+				if (res && res.status() == PGRES_PIPELINE_SYNC)
+					--pending_syncs;
+			}
+			if (!PQexitPipelineMode(m_conn))
 				throw error(m_conn);
+			throw;
 		}
-		if (!PQsetSingleRowMode(m_conn))
+		if (!PQexitPipelineMode(m_conn))
 			throw error(m_conn);
-		m_res = PQgetResult(m_conn);
-		verify_error<PGRES_COMMAND_OK, PGRES_SINGLE_TUPLE, PGRES_TUPLES_OK>();
+#else
+		for (size_t i = 0; it != last; ++i, ++it)
+		{
+			if (i % batch_size == 0) affected.push_back(0);
+			reset();
+			send_prepared(*it);
+			m_res = PQgetResult(m_conn);
+			verify_error<PGRES_COMMAND_OK, PGRES_TUPLES_OK>();
+			affected.back() += m_res.affected_rows();
+			finish(m_res);
+		}
+#endif //LIBPQ_HAS_PIPELINING
+		return affected;
 	}
 
+	// Rows are bound from the result in place, a partial result is replaced by the next one when its rows are fetched.
 	template<typename Types>
 	bool fetch(Types&& values)
 	{
-		if (m_res)
+		while (m_res)
 		{
 			ExecStatusType status = m_res.status();
-			if (status == PGRES_SINGLE_TUPLE)
+			bool partial = is_partial(status);
+			if (!partial && status != PGRES_TUPLES_OK)
+			{
+				verify_error<PGRES_TUPLES_OK>();
+				return false;
+			}
+			if (m_row < m_res.get_row_count())
 			{
-				int count = m_res.get_column_count();
-				if (count > 0)
+				bind_row(m_row);
+				if (m_bound_record != &values)
 				{
-					m_binders.resize(count);
-					for (int i = 0; i != count; i++)
-					{
-						m_binders[i]=binder(m_res.get_value(0, i), m_res.length(0, i), 
-							m_res.get_column_type(i));
-					}
-					qtl::bind_record(*this, std::forward<Types>(values));
+					qtl::plan_record(*this, values);
+					m_bound_record = &values;
 				}
-				m_res = PQgetResult(m_conn);
+				qtl::bind_record(*this, std::forward<Types>(values));
+				qtl::complete_fetch(values);
+				++m_row;
 				return true;
 			}
-			else
-			{
-				verify_error<PGRES_TUPLES_OK>();
-			}
+			if (!partial)
+				return false;
+			m_res = PQgetResult(m_conn);
+			m_row = 0;
 		}
 		return false;
 	}
 
-	bool next_result()
+	template<typename Record, typename Alloc>
+	size_t fetch_n(std::vector<Record, Alloc>& values, size_t count)
 	{
-		m_res = PQgetResult(m_conn);
-		return m_res && m_res.status() == PGRES_SINGLE_TUPLE;
+		return qtl::fetch_n(*this, values, count);
+	}
+
+	// Returns the count of rows if the whole result set has been received, otherwise 0.
+	size_t get_row_count() const
+	{
+		if (m_res && m_res.status() == PGRES_TUPLES_OK)
+			return static_cast<size_t>(m_res.get_row_count());
+		return 0;
+	}
+
+	bool next_result()
+	{
+		m_res = PQgetResult(m_conn);
+		m_row = 0;
+		m_bound_record = nullptr;
+		return m_res && (is_partial(m_res.status()) || m_res.status() == PGRES_TUPLES_OK);
 	}
 
 	void reset()
 	{
 		finish(m_res);
 		m_res.clear();
+		m_row = 0;
+		m_bound_record = nullptr;
+	}
+
+private:
+	template<typename Types>
+	void send_prepared(const Types& params)
+	{
+		reset_params(qtl::params_binder<statement, Types>::size);
+		qtl::bind_params(*this, params);
+		if (!send_params())
+			throw error(m_conn);
 	}
 };
 
 class base_database
 {
 protected:
-	base_database()
+	base_database() : m_registry(new statement_registry), m_fetch_mode(postgres::fetch_mode::single_row), m_chunk_size(256)
 	{
 		m_conn = nullptr;
 	}
@@ -2014,6 +2544,7 @@ public:
 
 	base_database(const base_database&) = delete;
 	base_database(base_database&& src)
+		: m_registry(std::move(src.m_registry)), m_fetch_mode(src.m_fetch_mode), m_chunk_size(src.m_chunk_size)
 	{
 		m_conn = src.m_conn;
 		src.m_conn = nullptr;
@@ -2033,6 +2564,9 @@ public:
 			if (m_conn)
 				PQfinish(m_conn);
 			m_conn = src.m_conn;
+			m_registry = std::move(src.m_registry);
+			m_fetch_mode = src.m_fetch_mode;
+			m_chunk_size = src.m_chunk_size;
 			src.m_conn = nullptr;
 		}
 		return *this;
@@ -2114,17 +2648,71 @@ public:
 	void reset()
 	{
 		if(status() == CONNECTION_BAD)
+		{
 			PQreset(m_conn);
+			if (m_registry) m_registry->clear();
+		}
 	}
 
 	void close()
 	{
 		PQfinish(m_conn);
 		m_conn = nullptr;
+		if (m_registry) m_registry->clear();
+	}
+
+	/*
+		Statements are kept prepared on the connection and reused, keyed by query text and parameter types.
+		At most capacity statements are kept, the default is 128, and 0 deallocates each statement when it is destroyed.
+	 */
+	void set_prepared_statement_limit(size_t capacity)
+	{
+		if (m_registry) m_registry->set_capacity(capacity);
+	}
+	size_t prepared_statement_limit() const
+	{
+		return m_registry ? m_registry->capacity() : 0;
+	}
+
+	/*
+		Prepares statements as the unnamed statement, which is replaced by the next one.
+		Use it behind a transaction pooler, where named statements may be prepared on another server connection.
+	 */
+	void use_unnamed_statements(bool on)
+	{
+		if (m_registry) m_registry->set_unnamed(on);
+	}
+
+	/*
+		Queries opened fewer than threshold times on the connection are not prepared,
+		each execution sends the query text with binary parameters in one round trip.
+		The default 1 prepares each query when it is opened, 0 never prepares.
+	 */
+	void set_prepare_threshold(unsigned threshold)
+	{
+		if (m_registry) m_registry->set_prepare_threshold(threshold);
+	}
+	unsigned prepare_threshold() const
+	{
+		return m_registry ? m_registry->prepare_threshold() : 1;
 	}
 
+	statement_registry* registry() { return m_registry.get(); }
+
+	// Fetch mode of statements created on the connection afterwards.
+	void set_fetch_mode(postgres::fetch_mode mode, int chunk_size = 256)
+	{
+		m_fetch_mode = mode;
+		m_chunk_size = chunk_size > 0 ? chunk_size : 1;
+	}
+	postgres::fetch_mode fetch_mode() const { return m_fetch_mode; }
+	int fetch_chunk_size() const { return m_chunk_size; }
+
 protected:
 	PGconn* m_conn;
+	std::unique_ptr<statement_registry> m_registry;
+	postgres::fetch_mode m_fetch_mode;
+	int m_chunk_size;
 	void throw_exception() { throw postgres::error(m_conn); }
 };
 
@@ -2137,25 +2725,9 @@ public:
 	}
 
 	template<typename ValueProc>
-	void fetch_all(ValueProc& proc)
+	void fetch_all(ValueProc&& proc)
 	{
-		int row_count = PQntuples(m_res.handle());
-		if (row_count > 0)
-		{
-			int col_count = m_res.get_column_count();
-			m_binders.resize(col_count);
-			auto values = qtl::detail::make_values(proc);
-			for (int i = 0; i != row_count; i++)
-			{
-				for (int j = 0; j != col_count; j++)
-				{
-					m_binders[j] = binder(m_res.get_value(i, j), m_res.length(i, j),
-						m_res.get_column_type(j));
-				}
-				qtl::bind_record(*this, std::forward<decltype(values)>(values));
-				qtl::detail::apply(proc, std::forward<decltype(values)>(values));
-			}
-		}
+		fetch_rows(*this, proc);
 	}
 };
 
@@ -2194,6 +2766,33 @@ public:
 		return m_conn != nullptr && status() == CONNECTION_OK;
 	}
 
+	void close()
+	{
+		clear_statement_cache();
+		postgres::base_database::close();
+	}
+
+	// Runs a COPY ... TO STDOUT (FORMAT binary) statement and calls proc with each row, as query does.
+	template<typename ValueProc>
+	void copy_to(const char* query_text, ValueProc&& proc);
+
+	// Cached statements are dropped, an unnamed statement is replaced by the next one and can not be cached.
+	void use_unnamed_statements(bool on)
+	{
+		if (on) clear_statement_cache();
+		postgres::base_database::use_unnamed_statements(on);
+	}
+	bool can_cache_statements() const
+	{
+		return m_registry == nullptr || !m_registry->unnamed();
+	}
+
+	// Deallocates statements evicted from the registry, it is also done when enough of them are pending.
+	void flush_deallocations()
+	{
+		if (m_registry) m_registry->flush(m_conn);
+	}
+
 	statement open_command(const char* query_text, size_t /*text_length*/)
 	{
 		statement stmt(*this);
@@ -2249,15 +2848,536 @@ public:
 	{
 		simple_execute("COMMIT");
 	}
-
-	bool is_alive()
+
+	bool is_alive()
+	{
+		qtl::postgres::result res(PQexec(m_conn, ""));
+		return res && res.status() == PGRES_COMMAND_OK;
+	}
+
+};
+
+#ifdef LIBPQ_HAS_PIPELINING
+
+/*
+	Queries of a pipeline are sent without waiting for results of previous ones, it needs libpq 14 or later.
+	Results are dispatched to the handlers of their queries in order, when the pipeline is synchronized.
+	After a query fails, the rest of queries before the next synchronization are aborted and their handlers receive errors.
+	A query kept by the registry of the connection is executed by its prepared statement, others are prepared in the pipeline
+	as the prepare threshold allows, or sent with their parameters by PQsendQueryParams.
+ */
+class base_pipeline : public base_statement
+{
+public:
+	explicit base_pipeline(base_database& db) : base_statement(db)
+	{
+		if (!PQenterPipelineMode(m_conn))
+			throw error(m_conn);
+	}
+	base_pipeline(const base_pipeline&) = delete;
+	base_pipeline& operator=(const base_pipeline&) = delete;
+	~base_pipeline()
+	{
+		PQexitPipelineMode(m_conn);
+	}
+
+	// Count of queries and synchronization points whose results are not dispatched yet.
+	size_t pending() const { return m_queue.size(); }
+
+protected:
+	typedef std::function<void(const error&, result&)> completion;
+	struct pending_query
+	{
+		completion complete;
+		// keeps the statement from being deallocated before it is executed
+		statement_registry::name_type prepared;
+		bool sync;
+	};
+	std::deque<pending_query> m_queue;
+
+	void push(completion&& complete, const statement_registry::name_type& prepared = nullptr, bool sync = false)
+	{
+		pending_query query = { std::move(complete), prepared, sync };
+		m_queue.push_back(std::move(query));
+	}
+
+	// Returns the statement prepared for the query, or nullptr to send the query with its parameters.
+	statement_registry::name_type prepare(const char* query_text)
+	{
+		if (!use_registry() || m_registry->unnamed())
+			return nullptr;
+		std::string key = statement_registry::make_key(query_text, 0, nullptr);
+		statement_registry::name_type name = m_registry->find(key);
+		if (name || !m_registry->should_prepare(query_text, 0, nullptr))
+			return name;
+		name = m_registry->insert(std::string(key), statement_registry::make_name());
+		if (!PQsendPrepare(m_conn, name->data(), query_text, 0, nullptr))
+		{
+			m_registry->remove(key, name);
+			throw error(m_conn);
+		}
+		statement_registry* registry = m_registry;
+		push([registry, key, name](const error& e, result&) {
+			if (e) registry->remove(key, name);
+		}, name);
+		return name;
+	}
+
+	template<typename Params>
+	void send(const char* query_text, const Params& params, completion&& complete)
+	{
+		statement_registry::name_type prepared = prepare(query_text);
+		reset_params(qtl::params_binder<base_pipeline, Params>::size);
+		qtl::bind_params(*this, params);
+		collect_params();
+		int count = static_cast<int>(m_binders.size());
+		int ok = prepared ?
+			PQsendQueryPrepared(m_conn, prepared->data(), count, m_values.data(), m_lengths.data(), m_formats.data(), 1) :
+			PQsendQueryParams(m_conn, query_text, count, nullptr, m_values.data(), m_lengths.data(), m_formats.data(), 1);
+		m_arena.clear();
+		if (!ok)
+			throw error(m_conn);
+		push(std::move(complete), prepared);
+	}
+
+	void send_sync(completion&& complete)
+	{
+		if (!PQpipelineSync(m_conn))
+			throw error(m_conn);
+		push(std::move(complete), nullptr, true);
+	}
+
+	// Dispatches a result to the oldest query, returns true if it is a synchronization point.
+	bool dispatch(result& res)
+	{
+		pending_query query = std::move(m_queue.front());
+		m_queue.pop_front();
+		error e;
+		if (res.status() == PGRES_PIPELINE_ABORTED)
+			e = error("pipeline aborted by a previous query");
+		else if (query.sync)
+			res.verify_error<PGRES_PIPELINE_SYNC>(e);
+		else
+			res.verify_error<PGRES_COMMAND_OK, PGRES_TUPLES_OK>(e);
+		query.complete(e, res);
+		return query.sync;
+	}
+
+	// Fails all queries when the connection is broken, the error is reported instead of exceptions thrown by handlers.
+	void fail_all(const error& e)
+	{
+		result res(nullptr);
+		while (!m_queue.empty())
+		{
+			pending_query query = std::move(m_queue.front());
+			m_queue.pop_front();
+			try
+			{
+				query.complete(e, res);
+			}
+			catch (...)
+			{
+			}
+		}
+	}
+
+	template<typename ValueProc>
+	void fetch_all(result& res, ValueProc& proc)
+	{
+		m_res = std::move(res);
+		fetch_rows(*this, proc);
+		m_res = nullptr;
+	}
+};
+
+/*
+	The pipeline is synchronized by sync, or when max_pending queries are queued.
+	Handlers are called by sync, exceptions thrown by them are rethrown when all results are dispatched.
+ */
+class pipeline : public base_pipeline
+{
+public:
+	explicit pipeline(database& db, size_t max_pending = qtl::batch_size)
+		: base_pipeline(db), m_max_pending(max_pending)
+	{
+	}
+	~pipeline()
+	{
+		try
+		{
+			sync();
+		}
+		catch (...)
+		{
+		}
+	}
+
+	/*
+		Handler defines as:
+		void handler(const qtl::postgres::error& e, uint64_t affected);
+		Without handler, the error of the query is thrown by sync.
+	 */
+	template<typename Params, typename Handler>
+	void execute(const char* query_text, const Params& params, Handler&& handler)
+	{
+		send(query_text, params, [handler](const error& e, result& res) mutable {
+			handler(e, e ? 0 : res.affected_rows());
+		});
+		if (m_queue.size() >= m_max_pending)
+			sync();
+	}
+	template<typename Params>
+	void execute(const char* query_text, const Params& params)
+	{
+		execute(query_text, params, [](const error& e, uint64_t) {
+			if (e) throw e;
+		});
+	}
+
+	// Calls proc with each row, the error of the query is thrown by sync.
+	template<typename Params, typename ValueProc>
+	void query(const char* query_text, const Params& params, ValueProc&& proc)
+	{
+		send(query_text, params, [this, proc](const error& e, result& res) mutable {
+			if (e) throw e;
+			fetch_all(res, proc);
+		});
+		if (m_queue.size() >= m_max_pending)
+			sync();
+	}
+
+	void sync()
+	{
+		if (m_queue.empty())
+			return;
+		send_sync([](const error&, result&) { });
+		std::exception_ptr failure;
+		bool synced = false;
+		while (!synced)
+		{
+			result res(PQgetResult(m_conn));
+			if (!res)
+			{
+				error e(m_conn);
+				fail_all(e);
+				throw e;
+			}
+			try
+			{
+				synced = dispatch(res);
+			}
+			catch (...)
+			{
+				if (!failure) failure = std::current_exception();
+			}
+			if (!synced)
+			{
+				// the results of a query are followed by nullptr
+				result tail(PQgetResult(m_conn));
+				finish(tail);
+			}
+		}
+		if (failure)
+			std::rethrow_exception(failure);
+	}
+
+private:
+	size_t m_max_pending;
+};
+
+#endif //LIBPQ_HAS_PIPELINING
+
+/*
+	Encodes records for COPY ... FROM STDIN (FORMAT binary), the fields of a record are bound as parameters of a query.
+	The types of fields should match the types of columns exactly, e.g. int32_t for integer and int64_t for bigint.
+ */
+class base_copy_writer : public base_statement
+{
+public:
+	base_copy_writer(base_database& db, size_t flush_size)
+		: base_statement(db), m_flush_size(flush_size), m_rows(0), m_open(false)
+	{
+	}
+	base_copy_writer(const base_copy_writer&) = delete;
+	base_copy_writer& operator=(const base_copy_writer&) = delete;
+
+	// Count of records written.
+	uint64_t rows() const { return m_rows; }
+	size_t flush_size() const { return m_flush_size; }
+	void set_flush_size(size_t flush_size) { m_flush_size = flush_size; }
+
+protected:
+	std::string m_buffer;
+	size_t m_flush_size;
+	uint64_t m_rows;
+	bool m_open;
+
+	void put_int16(int16_t v)
+	{
+		char data[2] = { static_cast<char>(v >> 8), static_cast<char>(v) };
+		m_buffer.append(data, sizeof(data));
+	}
+	void put_int32(int32_t v)
+	{
+		char data[4] = { static_cast<char>(v >> 24), static_cast<char>(v >> 16), static_cast<char>(v >> 8), static_cast<char>(v) };
+		m_buffer.append(data, sizeof(data));
+	}
+	void put_header()
+	{
+		static const char signature[] = "PGCOPY\n\377\r\n";
+		m_buffer.assign(signature, sizeof(signature)); // with the terminating zero
+		put_int32(0); // flags
+		put_int32(0); // length of header extension
+		m_rows = 0;
+		m_open = true;
+	}
+	void put_trailer()
+	{
+		put_int16(-1);
+	}
+
+	template<typename Record>
+	void encode(const Record& record)
+	{
+		const size_t count = qtl::params_binder<base_copy_writer, Record>::size;
+		reset_params(count);
+		qtl::bind_params(*this, record);
+		locate_params();
+		put_int16(static_cast<int16_t>(count));
+		for (const binder& field : m_binders)
+		{
+			if (field.value() == nullptr)
+			{
+				put_int32(-1);
+			}
+			else
+			{
+				put_int32(static_cast<int32_t>(field.length()));
+				m_buffer.append(field.value(), field.length());
+			}
+		}
+		++m_rows;
+	}
+};
+
+/*
+	Streams records to a COPY ... FROM STDIN (FORMAT binary) statement, data is sent when flush_size bytes are buffered.
+	The server reports a failed row when the copy ends, so errors of rows are thrown by end.
+	Destroying the writer before end aborts the copy.
+ */
+class copy_writer : public base_copy_writer
+{
+public:
+	copy_writer(database& db, const char* query_text, size_t flush_size = 64 * 1024)
+		: base_copy_writer(db, flush_size)
+	{
+		result res(PQexec(m_conn, query_text));
+		if (!res)
+			throw error(m_conn);
+		res.verify_error<PGRES_COPY_IN>();
+		put_header();
+	}
+	~copy_writer()
+	{
+		if (m_open && PQputCopyEnd(m_conn, "copy is aborted") == 1)
+		{
+			result res(PQgetResult(m_conn));
+			finish(res);
+		}
+	}
+
+	template<typename Record>
+	void write(const Record& record)
+	{
+		encode(record);
+		if (m_buffer.size() >= m_flush_size)
+			flush();
+	}
+	template<typename Range>
+	void write_all(const Range& records)
+	{
+		for (auto& record : records)
+			write(record);
+	}
+
+	void flush()
+	{
+		if (!m_buffer.empty())
+		{
+			if (PQputCopyData(m_conn, m_buffer.data(), static_cast<int>(m_buffer.size())) != 1)
+				throw error(m_conn);
+			m_buffer.clear();
+		}
+	}
+
+	// Ends the copy and returns the count of rows copied.
+	uint64_t end()
+	{
+		put_trailer();
+		flush();
+		m_open = false;
+		if (PQputCopyEnd(m_conn, nullptr) != 1)
+			throw error(m_conn);
+		result res(PQgetResult(m_conn));
+		if (!res)
+			throw error(m_conn);
+		error e;
+		res.verify_error<PGRES_COMMAND_OK>(e);
+		uint64_t affected = res.affected_rows();
+		finish(res);
+		if (e) throw e;
+		return affected;
+	}
+};
+
+/*
+	Reads rows from a COPY ... TO STDOUT (FORMAT binary) statement, each row is decoded in place from the copy data.
+	Binary copy data has no types, so the types of fields should match the types of columns exactly.
+	Destroying the reader before all rows are fetched cancels the copy.
+ */
+class copy_reader : public base_statement
+{
+public:
+	copy_reader(database& db, const char* query_text)
+		: base_statement(db), m_data(nullptr), m_open(false), m_header(true)
+	{
+		result res(PQexec(m_conn, query_text));
+		if (!res)
+			throw error(m_conn);
+		res.verify_error<PGRES_COPY_OUT>();
+		m_open = true;
+	}
+	copy_reader(const copy_reader&) = delete;
+	copy_reader& operator=(const copy_reader&) = delete;
+	~copy_reader()
+	{
+		free_data();
+		if (m_open)
+		{
+			PGcancel* cancel = PQgetCancel(m_conn);
+			if (cancel)
+			{
+				char errmsg[256];
+				PQcancel(cancel, errmsg, sizeof(errmsg));
+				PQfreeCancel(cancel);
+			}
+			while (PQgetCopyData(m_conn, &m_data, 0) >= 0)
+				free_data();
+			result res(PQgetResult(m_conn));
+			finish(res);
+		}
+	}
+
+	template<typename Types>
+	bool fetch(Types&& values)
+	{
+		while (m_open)
+		{
+			free_data();
+			int length = PQgetCopyData(m_conn, &m_data, 0);
+			if (length == -1)
+			{
+				m_open = false;
+				result res(PQgetResult(m_conn));
+				if (!res)
+					throw error(m_conn);
+				error e;
+				res.verify_error<PGRES_COMMAND_OK>(e);
+				finish(res);
+				if (e) throw e;
+				return false;
+			}
+			else if (length < 0)
+			{
+				throw error(m_conn);
+			}
+			const char* data = m_data;
+			const char* end = m_data + length;
+			if (m_header)
+			{
+				data = skip_header(data, end);
+				m_header = false;
+			}
+			if (data == end)
+				continue;
+			int16_t count = static_cast<int16_t>(get_int(data, end, 2));
+			if (count < 0) // trailer
+				continue;
+			m_binders.resize(count);
+			for (int16_t i = 0; i != count; i++)
+			{
+				int32_t size = static_cast<int32_t>(get_int(data, end, 4));
+				if (size < 0)
+				{
+					m_binders[i] = binder(nullptr, 0, InvalidOid);
+				}
+				else
+				{
+					if (end - data < size)
+						throw error("malformed copy data");
+					m_binders[i] = binder(data, size, InvalidOid);
+					data += size;
+				}
+			}
+			qtl::bind_record(*this, std::forward<Types>(values));
+			qtl::complete_fetch(values);
+			return true;
+		}
+		return false;
+	}
+
+	// Calls proc with each row as base_database::query does, it stops when proc returns false.
+	template<typename ValueProc>
+	void fetch_all(ValueProc&& proc)
+	{
+		qtl::detail::fetch_command(*this, std::forward<ValueProc>(proc));
+	}
+
+private:
+	char* m_data;
+	bool m_open;
+	bool m_header;
+
+	void free_data()
+	{
+		if (m_data)
+		{
+			PQfreemem(m_data);
+			m_data = nullptr;
+		}
+	}
+
+	static uint32_t get_int(const char*& data, const char* end, size_t size)
+	{
+		if (static_cast<size_t>(end - data) < size)
+			throw error("malformed copy data");
+		uint32_t v = 0;
+		for (size_t i = 0; i != size; i++)
+			v = (v << 8) | static_cast<unsigned char>(data[i]);
+		data += size;
+		return v;
+	}
+	static const char* skip_header(const char* data, const char* end)
 	{
-		qtl::postgres::result res(PQexec(m_conn, ""));
-		return res && res.status() == PGRES_COMMAND_OK;
+		static const char signature[] = "PGCOPY\n\377\r\n";
+		if (static_cast<size_t>(end - data) < sizeof(signature) || memcmp(data, signature, sizeof(signature)) != 0)
+			throw error("malformed copy data");
+		data += sizeof(signature);
+		get_int(data, end, 4); // flags
+		uint32_t extension = get_int(data, end, 4);
+		if (static_cast<size_t>(end - data) < extension)
+			throw error("malformed copy data");
+		return data + extension;
 	}
-
 };
 
+template<typename ValueProc>
+inline void database::copy_to(const char* query_text, ValueProc&& proc)
+{
+	copy_reader reader(*this, query_text);
+	reader.fetch_all(std::forward<ValueProc>(proc));
+}
+
 inline int event_flags(PostgresPollingStatusType status)
 {
 	int flags = 0;
@@ -2363,16 +3483,42 @@ public:
 		Handler defiens as:
 		void handler(const qtl::mysql::error& e);
 	 */
+	/*
+		A statement prepared before with the same text and parameter types is reused from the registry of the connection.
+		Evicted statements are deallocated after a new statement is prepared, when enough of them are pending.
+		Below the prepare threshold of the connection, it is not prepared but executed in one round trip.
+	 */
 	template<typename Handler>
 	void open(Handler&& handler, const char* command, int nParams = 0, const Oid *paramTypes = nullptr)
 	{
-		_name.resize(sizeof(intptr_t) * 2 + 1);
-		int n = sprintf(const_cast<char*>(_name.data()), "q%p", this);
-		_name.resize(n);
-		std::transform(_name.begin(), _name.end(), _name.begin(), tolower);
+		std::string key;
+		m_command.clear();
+		m_types.clear();
+		if (use_registry() && !m_registry->unnamed())
+		{
+			key = statement_registry::make_key(command, nParams, paramTypes);
+			if (find_prepared(key))
+			{
+				handler(error());
+				return;
+			}
+		}
+		if (open_direct(command, nParams, paramTypes))
+		{
+			handler(error());
+			return;
+		}
+		if (m_registry && m_registry->unnamed())
+		{
+			_name.clear();
+		}
+		else
+		{
+			_name = statement_registry::make_name();
+		}
 		if (PQsendPrepare(m_conn, _name.data(), command, nParams, paramTypes))
 		{
-			async_wait([this, handler](error e) mutable {
+			async_wait([this, handler, key](error e) mutable {
 				if (!e)
 				{
 					m_res = PQgetResult(m_conn);
@@ -2383,6 +3529,19 @@ public:
 							m_res = PQgetResult(m_conn);
 					}
 				}
+				if (e)
+				{
+					_name.clear();
+				}
+				else if (!key.empty())
+				{
+					m_prepared = m_registry->insert(std::move(key), std::string(_name));
+					if (m_registry->pending_deallocations() >= statement_registry::deallocation_batch)
+					{
+						deallocate(m_registry->take_deallocations(), handler);
+						return;
+					}
+				}
 				handler(e);
 			});
 		}
@@ -2412,7 +3571,7 @@ public:
 			m_res = PQgetResult(m_conn);
 		}
 
-		if (!_name.empty())
+		if (!_name.empty() && !m_prepared)
 		{
 			std::ostringstream oss;
 			oss << "DEALLOCATE " << _name << ";";
@@ -2422,6 +3581,8 @@ public:
 			finish(res);
 			if(e) throw e;
 		}
+		_name.clear();
+		m_prepared = nullptr;
 		base_statement::close();
 	}
 
@@ -2442,7 +3603,13 @@ public:
 			}
 		}
 
-		if (!_name.empty() && PQstatus(m_conn) == CONNECTION_OK)
+		if (m_prepared)
+		{
+			_name.clear();
+			m_prepared = nullptr;
+			handler(error());
+		}
+		else if (!_name.empty() && PQstatus(m_conn) == CONNECTION_OK)
 		{
 			std::ostringstream oss;
 			oss << "DEALLOCATE " << _name << ";";
@@ -2484,14 +3651,13 @@ public:
 	template<typename ExecuteHandler>
 	void execute(ExecuteHandler&& handler)
 	{
-		if (PQsendQueryPrepared(m_conn, _name.data(), 0, nullptr, nullptr, nullptr, 1) &&
-			PQsetSingleRowMode(m_conn))
+		if (send_query(0, nullptr, nullptr, nullptr) && set_row_mode())
 		{
 			async_wait([this, handler](error e) {
 				if (!e)
 				{
 					m_res = PQgetResult(m_conn);
-					m_res.verify_error<PGRES_COMMAND_OK, PGRES_SINGLE_TUPLE>(e);
+					verify_execute(e);
 					finish(m_res);
 				}
 				handler(e);
@@ -2506,57 +3672,38 @@ public:
 	template<typename Types, typename Handler>
 	void execute(const Types& params, Handler&& handler)
 	{
-		const size_t count = qtl::params_binder<statement, Types>::size;
-		if (count > 0)
-		{
-			m_binders.resize(count);
-			qtl::bind_params(*this, params);
-
-			std::array<const char*, count> values;
-			std::array<int, count> lengths;
-			std::array<int, count> formats;
-			for (size_t i = 0; i != m_binders.size(); i++)
-			{
-				values[i] = m_binders[i].value();
-				lengths[i] = static_cast<int>(m_binders[i].length());
-				formats[i] = 1;
-			}
-			if (!PQsendQueryPrepared(m_conn, _name.data(), static_cast<int>(m_binders.size()), values.data(), lengths.data(), formats.data(), 1))
-			{
-				handler(error(m_conn), 0);
-				return;
-			}
-		}
-		else
+		reset_params(qtl::params_binder<statement, Types>::size);
+		qtl::bind_params(*this, params);
+		if (!send_params())
 		{
-			if (!PQsendQueryPrepared(m_conn, _name.data(), 0, nullptr, nullptr, nullptr, 1))
-			{
-				handler(error(m_conn), 0);
-				return;
-			}
+			handler(error(m_conn), 0);
+			return;
 		}
-		if (!PQsetSingleRowMode(m_conn))
+		if (!set_row_mode())
 		{
 			handler(error(m_conn), 0);
 			return;
 		}
-		if (PQisBusy(m_conn))
-		{
-			async_wait([this, handler](error e) mutable {
-				if (!e)
-				{
-					m_res = PQgetResult(m_conn);
-					m_res.verify_error<PGRES_COMMAND_OK, PGRES_SINGLE_TUPLE>(e);
-					int64_t affected = m_res.affected_rows();
-					finish(m_res);
-					handler(e, affected);
-				}
-				else
+		async_wait([this, handler](error e) mutable {
+			if (!e)
+			{
+				m_res = PQgetResult(m_conn);
+				verify_execute(e);
+				int64_t affected = 0;
+				if (!e && !is_partial(m_res.status()))
 				{
-					handler(e, 0);
+					affected = m_res.affected_rows();
+					// rows of a buffered result are left to fetch
+					if (m_res.status() != PGRES_TUPLES_OK)
+						finish(m_res);
 				}
-			});
-		}
+				handler(e, affected);
+			}
+			else
+			{
+				handler(e, 0);
+			}
+		});
 	}
 
 	template<typename Types, typename RowHandler, typename FinishHandler>
@@ -2565,21 +3712,26 @@ public:
 		if (m_res)
 		{
 			ExecStatusType status = m_res.status();
-			if (status == PGRES_SINGLE_TUPLE)
+			if (is_partial(status) || (status == PGRES_TUPLES_OK && m_row < m_res.get_row_count()))
 			{
-				int count = m_res.get_column_count();
-				if (count > 0)
+				int rows = m_res.get_row_count();
+				if (rows > m_row && m_bound_record != &values)
 				{
-					m_binders.resize(count);
-					for (int i = 0; i != count; i++)
-					{
-						m_binders[i] = binder(m_res.get_value(0, i), m_res.length(0, i),
-							m_res.get_column_type(i));
-					}
+					qtl::plan_record(*this, values);
+					m_bound_record = &values;
+				}
+				for (int i = m_row; i < rows; i++)
+				{
+					bind_row(i);
 					qtl::bind_record(*this, std::forward<Types>(values));
+					row_handler();
 				}
-				row_handler();
-				if (PQisBusy(m_conn))
+				m_row = rows;
+				if (!is_partial(status))
+				{
+					finish_handler(error());
+				}
+				else if (PQisBusy(m_conn))
 				{
 					async_wait([this, &values, row_handler, finish_handler](const error& e) {
 						if (e)
@@ -2589,6 +3741,7 @@ public:
 						else
 						{
 							m_res = PQgetResult(m_conn);
+							m_row = 0;
 							fetch(std::forward<Types>(values), row_handler, finish_handler);
 						}
 					});
@@ -2596,6 +3749,7 @@ public:
 				else
 				{
 					m_res = PQgetResult(m_conn);
+					m_row = 0;
 					fetch(std::forward<Types>(values), row_handler, finish_handler);
 				}
 			}
@@ -2623,6 +3777,8 @@ public:
 			else
 			{
 				m_res = PQgetResult(m_conn);
+				m_row = 0;
+				m_bound_record = nullptr;
 				handler(error());
 			}
 		});
@@ -2636,6 +3792,22 @@ private:
 	{
 		qtl::postgres::async_wait(m_event, m_conn, m_timeout, std::forward<Handler>(handler));
 	}
+
+	// Failures of deallocation are ignored, the statements are dropped with the connection anyway.
+	template<typename Handler>
+	void deallocate(const std::string& query_text, Handler& handler)
+	{
+		if (query_text.empty() || !PQsendQuery(m_conn, query_text.data()))
+		{
+			handler(error());
+			return;
+		}
+		async_wait([this, handler](const error&) mutable {
+			result res(PQgetResult(m_conn));
+			finish(res);
+			handler(error());
+		});
+	}
 };
 
 class async_connection : public base_database, public qtl::async_connection<async_connection, async_statement>
@@ -2814,7 +3986,9 @@ public:
 	template<typename Handler>
 	void is_alive(Handler&& handler) NOEXCEPT
 	{
-		simple_execute(std::forward<Handler>(handler), "");
+		simple_execute([handler](const postgres::error& e, uint64_t) mutable {
+			handler(e);
+		}, "");
 	}
 
 	socket_type socket() const NOEXCEPT { return PQsocket(m_conn); }
@@ -2905,6 +4079,292 @@ private:
 
 };
 
+/*
+	Buffers records written to a COPY ... FROM STDIN (FORMAT binary) statement, write returns true when flush_size bytes are buffered,
+	then flush should be called before writing more.
+	The writer should live until the handler of end is called.
+ */
+class async_copy_writer : public base_copy_writer
+{
+public:
+	explicit async_copy_writer(async_connection& db, size_t flush_size = 64 * 1024)
+		: base_copy_writer(static_cast<base_database&>(db), flush_size), m_event(db.event()), m_timeout(db.query_timeout())
+	{
+	}
+
+	/*
+		Handler defines as:
+		void handler(const qtl::postgres::error& e);
+	 */
+	template<typename Handler>
+	void open(const char* query_text, Handler&& handler)
+	{
+		if (!PQsendQuery(m_conn, query_text))
+		{
+			handler(error(m_conn));
+			return;
+		}
+		async_wait(m_event, m_conn, m_timeout, [this, handler](error e) mutable {
+			if (!e)
+			{
+				result res(PQgetResult(m_conn));
+				if (res)
+					res.verify_error<PGRES_COPY_IN>(e);
+				else
+					e = error(m_conn);
+				if (!e)
+					put_header();
+				else
+					finish(res);
+			}
+			handler(e);
+		});
+	}
+
+	template<typename Record>
+	bool write(const Record& record)
+	{
+		encode(record);
+		return m_buffer.size() >= m_flush_size;
+	}
+
+	/*
+		Handler defines as:
+		void handler(const qtl::postgres::error& e);
+	 */
+	template<typename Handler>
+	void flush(Handler&& handler)
+	{
+		if (m_buffer.empty())
+		{
+			flush_output(handler);
+			return;
+		}
+		int ret = PQputCopyData(m_conn, m_buffer.data(), static_cast<int>(m_buffer.size()));
+		if (ret < 0)
+		{
+			handler(error(m_conn));
+		}
+		else if (ret == 0)
+		{
+			wait_writable([this, handler](const error& e) mutable {
+				if (e) handler(e);
+				else flush(handler);
+			});
+		}
+		else
+		{
+			m_buffer.clear();
+			flush_output(handler);
+		}
+	}
+
+	/*
+		Ends the copy, Handler defines as:
+		void handler(const qtl::postgres::error& e, uint64_t affected);
+	 */
+	template<typename Handler>
+	void end(Handler&& handler)
+	{
+		put_trailer();
+		flush([this, handler](const error& e) mutable {
+			if (e)
+				handler(e, 0);
+			else
+				put_end(handler);
+		});
+	}
+
+private:
+	event* m_event;
+	int m_timeout;
+
+	template<typename Handler>
+	void wait_writable(Handler&& handler)
+	{
+		m_event->set_io_handler(qtl::event::ef_write, m_timeout, [handler](int flags) mutable {
+			if (flags&qtl::event::ef_timeout)
+				handler(postgres::timeout());
+			else
+				handler(error());
+		});
+	}
+
+	template<typename Handler>
+	void flush_output(Handler& handler)
+	{
+		int ret = PQflush(m_conn);
+		if (ret < 0)
+		{
+			handler(error(m_conn));
+		}
+		else if (ret == 0)
+		{
+			handler(error());
+		}
+		else
+		{
+			wait_writable([this, handler](const error& e) mutable {
+				if (e) handler(e);
+				else flush_output(handler);
+			});
+		}
+	}
+
+	template<typename Handler>
+	void put_end(Handler& handler)
+	{
+		int ret = PQputCopyEnd(m_conn, nullptr);
+		if (ret < 0)
+		{
+			handler(error(m_conn), 0);
+		}
+		else if (ret == 0)
+		{
+			wait_writable([this, handler](const error& e) mutable {
+				if (e) handler(e, 0);
+				else put_end(handler);
+			});
+		}
+		else
+		{
+			m_open = false;
+			async_wait(m_event, m_conn, m_timeout, [this, handler](error e) mutable {
+				uint64_t affected = 0;
+				if (!e)
+				{
+					result res(PQgetResult(m_conn));
+					if (res)
+					{
+						res.verify_error<PGRES_COMMAND_OK>(e);
+						affected = res.affected_rows();
+					}
+					else
+					{
+						e = error(m_conn);
+					}
+					finish(res);
+				}
+				handler(e, affected);
+			});
+		}
+	}
+};
+
+#ifdef LIBPQ_HAS_PIPELINING
+
+/*
+	Results are received by the event loop after sync is called.
+	The pipeline should live until the handler of its last synchronization point is called.
+ */
+class async_pipeline : public base_pipeline
+{
+public:
+	explicit async_pipeline(async_connection& db)
+		: base_pipeline(static_cast<base_database&>(db)), m_event(db.event()), m_timeout(db.query_timeout()), m_syncs(0), m_receiving(false)
+	{
+	}
+
+	/*
+		Handler defines as:
+		void handler(const qtl::postgres::error& e, uint64_t affected);
+	 */
+	template<typename Params, typename Handler>
+	void execute(const char* query_text, const Params& params, Handler&& handler)
+	{
+		try
+		{
+			send(query_text, params, [handler](const error& e, result& res) mutable {
+				handler(e, e ? 0 : res.affected_rows());
+			});
+		}
+		catch (const error& e)
+		{
+			handler(e, 0);
+		}
+	}
+
+	/*
+		RowHandler is called with each row, FinishHandler defines as:
+		void handler(const qtl::postgres::error& e);
+	 */
+	template<typename Params, typename RowHandler, typename FinishHandler>
+	void query(const char* query_text, const Params& params, RowHandler&& row_handler, FinishHandler&& finish_handler)
+	{
+		try
+		{
+			send(query_text, params, [this, row_handler, finish_handler](const error& e, result& res) mutable {
+				if (!e) fetch_all(res, row_handler);
+				finish_handler(e);
+			});
+		}
+		catch (const error& e)
+		{
+			finish_handler(e);
+		}
+	}
+
+	/*
+		Handler defines as:
+		void handler(const qtl::postgres::error& e);
+		It is called after the results of queries queued before are dispatched.
+	 */
+	template<typename Handler>
+	void sync(Handler&& handler)
+	{
+		try
+		{
+			send_sync([handler](const error& e, result&) mutable {
+				handler(e);
+			});
+		}
+		catch (const error& e)
+		{
+			handler(e);
+			return;
+		}
+		++m_syncs;
+		if (!m_receiving)
+			receive();
+	}
+
+private:
+	event* m_event;
+	int m_timeout;
+	size_t m_syncs; // synchronization points whose results are not received
+	bool m_receiving;
+
+	void receive()
+	{
+		m_receiving = true;
+		qtl::postgres::async_wait(m_event, m_conn, m_timeout, [this](const error& e) {
+			if (e)
+			{
+				m_syncs = 0;
+				m_receiving = false;
+				fail_all(e);
+				return;
+			}
+			while (!PQisBusy(m_conn))
+			{
+				result res(PQgetResult(m_conn));
+				if (!res) continue; // end of the results of a query
+				// the pipeline may be destroyed by the handler of its last synchronization point
+				if (m_queue.front().sync && --m_syncs == 0)
+				{
+					m_receiving = false;
+					dispatch(res);
+					return;
+				}
+				dispatch(res);
+			}
+			receive();
+		});
+	}
+};
+
+#endif //LIBPQ_HAS_PIPELINING
+
 inline async_statement::async_statement(async_connection& db)
 	: base_statement(static_cast<base_database&>(db))
 {
@@ -2921,14 +4381,26 @@ using query_iterator = qtl::query_iterator<statement, Record>;
 template<typename Record>
 using query_result = qtl::query_result<statement, Record>;
 
-inline base_statement::base_statement(base_database& db) : m_res(nullptr)
+inline base_statement::base_statement(base_database& db)
+	: m_res(nullptr), m_row(0), m_bound_record(nullptr), m_fetch_mode(db.fetch_mode()), m_chunk_size(db.fetch_chunk_size())
 {
 	m_conn = db.handle();
+	m_registry = db.registry();
 	m_res = nullptr;
 }
 
 }
 
+template<>
+struct batch_executor<postgres::statement>
+{
+	template<typename Range>
+	std::vector<uint64_t> operator()(postgres::statement& command, const Range& params, size_t batch_size) const
+	{
+		return command.execute_batch(params, batch_size);
+	}
+};
+
 }
 
 
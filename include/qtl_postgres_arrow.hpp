@@ -0,0 +1,193 @@
+#ifndef _QTL_POSTGRES_ARROW_H_
+#define _QTL_POSTGRES_ARROW_H_
+
+#include "qtl_postgres.hpp"
+#include "qtl_arrow.hpp"
+
+namespace qtl
+{
+
+namespace postgres
+{
+
+/*
+	Reads the rows of an executed statement into Arrow arrays.
+	Columns are typed by the OIDs of their types,
+	fields of types which have no Arrow counterpart are copied in their binary format.
+ */
+class arrow_reader : public qtl::arrow::basic_reader<arrow_reader>
+{
+public:
+	explicit arrow_reader(statement& stmt) : m_stmt(stmt), m_started(false), m_row(0)
+	{
+		result& res = stmt.get_result();
+		if (res)
+		{
+			int count = static_cast<int>(res.get_column_count());
+			m_types.resize(count);
+			for (int i = 0; i != count; i++)
+			{
+				m_types[i] = res.get_column_type(i);
+				add_column(res.get_column_name(i), arrow_type(m_types[i]));
+			}
+		}
+	}
+
+	bool fetch_row()
+	{
+		result& res = m_stmt.get_result();
+		if (m_started)
+		{
+			if (++m_row < res.get_row_count())
+				return true;
+			if (!statement::is_partial(res.status()))
+				return false;
+			m_stmt.next_result();
+		}
+		m_started = true;
+		m_row = 0;
+		if (!res) return false;
+		ExecStatusType status = res.status();
+		if (!statement::is_partial(status) && status != PGRES_TUPLES_OK)
+		{
+			res.verify_error<PGRES_COMMAND_OK>();
+			return false;
+		}
+		return res.get_row_count() > 0;
+	}
+
+	void read_field(size_t col, qtl::arrow::column_builder& column)
+	{
+		const result& res = m_stmt.get_result();
+		int row = static_cast<int>(m_row), index = static_cast<int>(col);
+		if (res.is_null(row, index))
+		{
+			column.append_null();
+			return;
+		}
+		const char* value = res.get_value(row, index);
+		switch (m_types[col])
+		{
+		case BOOLOID:
+			column.append(*value != 0);
+			break;
+		case CHAROID:
+			column.append<int8_t>(*value);
+			break;
+		case INT2OID:
+			column.append(get<int16_t>(value));
+			break;
+		case INT4OID:
+			column.append(get<int32_t>(value));
+			break;
+		case INT8OID:
+			column.append(get<int64_t>(value));
+			break;
+		case OIDOID:
+			column.append(get<uint32_t>(value));
+			break;
+		case FLOAT4OID:
+		{
+			uint32_t bits = get<uint32_t>(value);
+			float v;
+			memcpy(&v, &bits, sizeof(v));
+			column.append(v);
+			break;
+		}
+		case FLOAT8OID:
+		{
+			uint64_t bits = get<uint64_t>(value);
+			double v;
+			memcpy(&v, &bits, sizeof(v));
+			column.append(v);
+			break;
+		}
+		case DATEOID:
+		{
+			int32_t days = get<int32_t>(value);
+			if (days != INT32_MAX && days != INT32_MIN) // not infinity
+				days += epoch_days;
+			column.append(days);
+			break;
+		}
+		case TIMEOID:
+			column.append(get<int64_t>(value));
+			break;
+		case TIMESTAMPOID:
+		case TIMESTAMPTZOID:
+		{
+			int64_t microseconds = get<int64_t>(value);
+			if (microseconds != INT64_MAX && microseconds != INT64_MIN) // not infinity
+				microseconds += epoch_days * INT64_C(86400000000);
+			column.append(microseconds);
+			break;
+		}
+		default:
+			column.append(value, res.length(row, index));
+			break;
+		}
+	}
+
+private:
+	statement& m_stmt;
+	std::vector<Oid> m_types;
+	bool m_started;
+	int64_t m_row;
+
+	// Days from 1970-01-01 to 2000-01-01, which is the epoch of PostgreSQL.
+	enum { epoch_days = 10957 };
+
+	template<typename T>
+	static T get(const char* value)
+	{
+		T v;
+		memcpy(&v, value, sizeof(T));
+		return static_cast<T>(detail::ntoh(v));
+	}
+
+	static qtl::arrow::type arrow_type(Oid oid)
+	{
+		switch (oid)
+		{
+		case BOOLOID:
+			return qtl::arrow::type::boolean;
+		case CHAROID:
+			return qtl::arrow::type::int8;
+		case INT2OID:
+			return qtl::arrow::type::int16;
+		case INT4OID:
+			return qtl::arrow::type::int32;
+		case INT8OID:
+			return qtl::arrow::type::int64;
+		case OIDOID:
+			return qtl::arrow::type::uint32;
+		case FLOAT4OID:
+			return qtl::arrow::type::float32;
+		case FLOAT8OID:
+			return qtl::arrow::type::float64;
+		case TEXTOID:
+		case VARCHAROID:
+		case BPCHAROID:
+		case NAMEOID:
+		case JSONOID:
+		case XMLOID:
+			return qtl::arrow::type::utf8;
+		case DATEOID:
+			return qtl::arrow::type::date32;
+		case TIMEOID:
+			return qtl::arrow::type::time64;
+		case TIMESTAMPOID:
+			return qtl::arrow::type::timestamp;
+		case TIMESTAMPTZOID:
+			return qtl::arrow::type::timestamp_utc;
+		default:
+			return qtl::arrow::type::binary;
+		}
+	}
+};
+
+}
+
+}
+
+#endif //_QTL_POSTGRES_ARROW_H_
@@ -4,6 +4,7 @@
 
 #ifdef _QTL_ENABLE_CPP26
 
+#include <array>
 #include <meta>
 #include "qtl_minmax.hpp"
 
@@ -148,11 +149,11 @@ struct simple_matcher
 template<class T, typename Matcher, typename = typename std::enable_if<std::is_class<T>::value>::type>
 struct auto_bind_t
 {
-	auto_bind_t(Matcher matcher) : _record(*new(_defvalue)T()), _matcher(matcher) { }
-	explicit auto_bind_t(T& value, Matcher matcher) : _record(value), _matcher(matcher) { }
+	auto_bind_t(Matcher matcher) : _record(*new(_defvalue)T()), _matcher(matcher), _planned(false) { }
+	explicit auto_bind_t(T& value, Matcher matcher) : _record(value), _matcher(matcher), _planned(false) { }
 	template<typename... Args>
 	explicit auto_bind_t(Matcher matcher, Args&&... args)
-		: _record(*new(_defvalue) T(args...)), _matcher(matcher)
+		: _record(*new(_defvalue) T(args...)), _matcher(matcher), _planned(false)
 	{
 	}
 	~auto_bind_t()
@@ -160,31 +161,48 @@ struct auto_bind_t
 		detail::destroy_trivially(&_record, reinterpret_cast<T*>(_defvalue));
 	}
 
+	// Matches members to columns by name, the result is used by all rows of the result set.
+	template<typename Command>
+	void plan(Command& command)
+	{
+		_columns.fill(npos);
+		const size_t count = command.get_column_count();
+		for (size_t i = 0; i != count; i++)
+		{
+			size_t index = 0;
+			const char* name = command.get_column_name(i);
+			template for (constexpr auto member : std::define_static_array(std::meta::nonstatic_data_members_of(^^T, std::meta::access_context::unchecked()))) {
+				if (_matcher(std::meta::identifier_of(member), name))
+					_columns[index] = i;
+				index++;
+			}
+		}
+		_planned = true;
+	}
+
 	template<typename Command>
 	void bind(Command& command)
 	{
+		if (!_planned)
+			plan(command);
+		size_t index = 0;
 		template for (constexpr auto member : std::define_static_array(std::meta::nonstatic_data_members_of(^^T, std::meta::access_context::unchecked()))) {
-			this->bind_field(command, std::meta::identifier_of(member), _record.[:member:]);
+			if (_columns[index] != npos)
+				qtl::bind_field(command, _columns[index], _record.[:member:]);
+			index++;
 		}
 	}
 
 	operator T&() { return _record; }
 
 private:
+	static constexpr size_t npos = static_cast<size_t>(-1);
+	static constexpr size_t member_count = std::meta::nonstatic_data_members_of(^^T, std::meta::access_context::unchecked()).size();
 	char _defvalue[sizeof(T)];
 	T& _record;
 	Matcher _matcher;
-
-	template<typename Command, typename Type>
-	void bind_field(Command& command, const std::string_view& member_name, Type&& member)
-	{
-		size_t count = command.get_column_count();
-		for (size_t i = 0; i != count; i++)
-		{
-			if (_matcher(member_name, command.get_column_name(i)))
-				qtl::bind_field(command, i, std::forward<Type>(member));
-		}
-	}
+	std::array<size_t, member_count> _columns; // column of each member, npos if no column matches
+	bool _planned;
 };
 
 template<class T, typename Matcher = simple_matcher>
@@ -214,6 +232,15 @@ struct record_binder<Command, auto_bind_t<T, Matcher>>
 	}
 };
 
+template<typename Command, typename T, typename Matcher>
+struct record_planner<Command, auto_bind_t<T, Matcher>>
+{
+	void operator()(Command& command, auto_bind_t<T, Matcher>& record) const
+	{
+		record.plan(command);
+	}
+};
+
 }
 
 #endif
@@ -39,11 +39,11 @@ private:
 class statement final
 {
 public:
-	statement() : m_stmt(NULL), m_fetch_result(SQLITE_OK) { }
+	statement() : m_stmt(NULL), m_fetch_result(SQLITE_OK), m_bound_record(NULL) { }
 	statement(const statement&) = delete;
 	statement(statement&& src) 
 		: m_stmt(src.m_stmt), m_fetch_result(src.m_fetch_result),
-		m_tail_text(std::forward<std::string>(src.m_tail_text))
+		m_tail_text(std::forward<std::string>(src.m_tail_text)), m_bound_record(src.m_bound_record)
 	{
 		src.m_stmt=NULL;
 		src.m_fetch_result=SQLITE_OK;
@@ -56,6 +56,7 @@ public:
 			m_stmt=src.m_stmt;
 			m_fetch_result=src.m_fetch_result;
 			m_tail_text=std::forward<std::string>(src.m_tail_text);
+			m_bound_record=src.m_bound_record;
 			src.m_stmt=NULL;
 			src.m_fetch_result=SQLITE_OK;
 		}
@@ -70,6 +71,7 @@ public:
 	{
 		const char* tail=NULL;
 		close();
+		m_bound_record=NULL;
 		verify_error(sqlite3_prepare_v2(db, query_text, (int)text_length, &m_stmt, &tail));
 		if(tail!=NULL)
 		{
@@ -360,6 +362,11 @@ public:
 	{
 		return sqlite3_column_type(m_stmt, col);
 	}
+	const char* get_column_decltype(int col) const
+	{
+		return sqlite3_column_decltype(m_stmt, col);
+	}
+	sqlite3_stmt* handle() const { return m_stmt; }
 	void clear_bindings()
 	{
 		sqlite3_clear_bindings(m_stmt);
@@ -367,6 +374,8 @@ public:
 	void reset()
 	{
 		sqlite3_reset(m_stmt);
+		m_fetch_result=SQLITE_OK;
+		m_bound_record=NULL;
 	}
 
 	template<typename Types>
@@ -377,9 +386,46 @@ public:
 		{
 			qtl::bind_params(*this, params);
 		}
+		m_bound_record=NULL;
 		fetch();
 	}
 
+	// Each batch is executed in a transaction unless a transaction has been opened.
+	template<typename Range>
+	std::vector<uint64_t> execute_batch(const Range& params, size_t batch_size)
+	{
+		sqlite3* db=sqlite3_db_handle(m_stmt);
+		std::vector<uint64_t> affected;
+		auto it=std::begin(params);
+		auto last=std::end(params);
+		while(it!=last)
+		{
+			bool autocommit=sqlite3_get_autocommit(db)!=0;
+			uint64_t count=0;
+			if(autocommit)
+				verify_error(sqlite3_exec(db, "BEGIN", NULL, NULL, NULL));
+			try
+			{
+				for(size_t i=0; i!=batch_size && it!=last; ++i, ++it)
+				{
+					reset();
+					execute(*it);
+					count+=sqlite3_changes(db);
+				}
+				if(autocommit)
+					verify_error(sqlite3_exec(db, "COMMIT", NULL, NULL, NULL));
+			}
+			catch(...)
+			{
+				if(autocommit)
+					sqlite3_exec(db, "ROLLBACK", NULL, NULL, NULL);
+				throw;
+			}
+			affected.push_back(count);
+		}
+		return affected;
+	}
+
 	template<typename Types>
 	bool fetch(Types&& values)
 	{
@@ -389,12 +435,38 @@ public:
 		if(m_fetch_result==SQLITE_ROW)
 		{
 			result=true;
+			if(m_bound_record!=&values)
+			{
+				qtl::plan_record(*this, values);
+				m_bound_record=&values;
+			}
 			qtl::bind_record(*this, std::forward<Types>(values));
+			qtl::complete_fetch(values);
 			m_fetch_result=SQLITE_OK;
 		}
 		return result;
 	}
 
+	template<typename Record, typename Alloc>
+	size_t fetch_n(std::vector<Record, Alloc>& values, size_t count)
+	{
+		return qtl::fetch_n(*this, values, count);
+	}
+
+	// Moves to the next row without binding it, fields of the row are read from handle().
+	bool step()
+	{
+		if(m_fetch_result==SQLITE_OK)
+			fetch();
+		if(m_fetch_result!=SQLITE_ROW)
+			return false;
+		m_fetch_result=SQLITE_OK;
+		return true;
+	}
+
+	// SQLite does not know the count of rows until all of them are stepped.
+	size_t get_row_count() const { return 0; }
+
 	bool next_result()
 	{
 		sqlite3* db=sqlite3_db_handle(m_stmt);
@@ -429,6 +501,7 @@ protected:
 	std::string m_tail_text;
 	
 	int m_fetch_result;
+	const void* m_bound_record; // record which columns of the result set are planned for
 	void verify_error(int e)
 	{
 		if(e!=SQLITE_OK) throw error(e);
@@ -443,7 +516,7 @@ public:
 	database() : m_db(NULL) { }
 	~database() { close(); }
 	database(const database&) = delete;
-	database(database&& src)
+	database(database&& src) : base_database(std::move(src))
 	{
 		m_db=src.m_db;
 		src.m_db=NULL;
@@ -454,6 +527,7 @@ public:
 		if(this!=&src)
 		{
 			close();
+			base_database::operator=(std::move(src));
 			m_db=src.m_db;
 			src.m_db=NULL;
 		}
@@ -474,6 +548,7 @@ public:
 	}
 	void close()
 	{
+		clear_statement_cache();
 		if(m_db)
 		{
 			sqlite3_close_v2(m_db);
@@ -1132,6 +1207,16 @@ inline const wchar_t* statement::get_text_value<wchar_t>(int col) const
 
 }
 
+template<>
+struct batch_executor<sqlite::statement>
+{
+	template<typename Range>
+	std::vector<uint64_t> operator()(sqlite::statement& command, const Range& params, size_t batch_size) const
+	{
+		return command.execute_batch(params, batch_size);
+	}
+};
+
 }
 
 #endif //_QTL_SQLITE_H_
@@ -0,0 +1,123 @@
+#ifndef _QTL_SQLITE_ARROW_H_
+#define _QTL_SQLITE_ARROW_H_
+
+#include <ctype.h>
+#include "qtl_sqlite.hpp"
+#include "qtl_arrow.hpp"
+
+namespace qtl
+{
+
+namespace sqlite
+{
+
+/*
+	Reads the rows of an executed statement into Arrow arrays.
+	Columns are typed by the affinity of their declared types.
+	Columns without declared type or with NUMERIC affinity are typed by their values in the first row.
+ */
+class arrow_reader : public qtl::arrow::basic_reader<arrow_reader>
+{
+public:
+	explicit arrow_reader(statement& stmt) : m_stmt(stmt), m_described(false) { }
+
+	bool fetch_row()
+	{
+		bool has_row=m_stmt.step();
+		if(!m_described)
+		{
+			describe(has_row);
+			m_described=true;
+		}
+		return has_row;
+	}
+
+	void read_field(size_t col, qtl::arrow::column_builder& column)
+	{
+		sqlite3_stmt* stmt=m_stmt.handle();
+		int index=static_cast<int>(col);
+		if(sqlite3_column_type(stmt, index)==SQLITE_NULL)
+		{
+			column.append_null();
+			return;
+		}
+		switch(column.type())
+		{
+		case qtl::arrow::type::int64:
+			column.append<int64_t>(sqlite3_column_int64(stmt, index));
+			break;
+		case qtl::arrow::type::float64:
+			column.append<double>(sqlite3_column_double(stmt, index));
+			break;
+		case qtl::arrow::type::utf8:
+		{
+			const unsigned char* text=sqlite3_column_text(stmt, index);
+			column.append(text, sqlite3_column_bytes(stmt, index));
+			break;
+		}
+		default:
+		{
+			const void* data=sqlite3_column_blob(stmt, index);
+			column.append(data, sqlite3_column_bytes(stmt, index));
+			break;
+		}
+		}
+	}
+
+private:
+	statement& m_stmt;
+	bool m_described;
+
+	void describe(bool has_row)
+	{
+		int count=m_stmt.get_column_count();
+		for(int i=0; i!=count; i++)
+		{
+			qtl::arrow::type type=affinity_type(m_stmt.get_column_decltype(i));
+			if(type==qtl::arrow::type::null)
+				type=has_row ? value_type(m_stmt.get_column_type(i)) : qtl::arrow::type::utf8;
+			add_column(m_stmt.get_column_name(i), type);
+		}
+	}
+
+	// Returns null type if the column is typed by its values.
+	static qtl::arrow::type affinity_type(const char* decltype_name)
+	{
+		if(decltype_name==NULL || *decltype_name=='\0')
+			return qtl::arrow::type::null;
+		std::string name(decltype_name);
+		std::transform(name.begin(), name.end(), name.begin(), ::toupper);
+		if(name.find("INT")!=std::string::npos)
+			return qtl::arrow::type::int64;
+		if(name.find("CHAR")!=std::string::npos || name.find("CLOB")!=std::string::npos ||
+			name.find("TEXT")!=std::string::npos)
+			return qtl::arrow::type::utf8;
+		if(name.find("BLOB")!=std::string::npos)
+			return qtl::arrow::type::binary;
+		if(name.find("REAL")!=std::string::npos || name.find("FLOA")!=std::string::npos ||
+			name.find("DOUB")!=std::string::npos)
+			return qtl::arrow::type::float64;
+		return qtl::arrow::type::null;
+	}
+
+	static qtl::arrow::type value_type(int type)
+	{
+		switch(type)
+		{
+		case SQLITE_INTEGER:
+			return qtl::arrow::type::int64;
+		case SQLITE_FLOAT:
+			return qtl::arrow::type::float64;
+		case SQLITE_BLOB:
+			return qtl::arrow::type::binary;
+		default:
+			return qtl::arrow::type::utf8;
+		}
+	}
+};
+
+}
+
+}
+
+#endif //_QTL_SQLITE_ARROW_H_
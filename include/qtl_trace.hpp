@@ -0,0 +1,254 @@
+#ifndef _QTL_TRACE_H_
+#define _QTL_TRACE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <tuple>
+#include <utility>
+#include <type_traits>
+#ifdef QTL_ENABLE_TRACE
+#include <atomic>
+#include <chrono>
+#include <string>
+#endif //QTL_ENABLE_TRACE
+
+namespace qtl
+{
+
+/*
+	Phases of a query reported to the query observer.
+	prepare is reported only when a statement is prepared, not when it is taken from the statement cache.
+	first_row is reported when the first row is fetched, it measures the time from the start of fetching.
+	fetch is reported when fetching is finished.
+ */
+enum class query_phase
+{
+	prepare,
+	execute,
+	first_row,
+	fetch
+};
+
+#ifdef QTL_ENABLE_TRACE
+
+struct query_event
+{
+	typedef std::chrono::steady_clock clock;
+
+	query_phase phase;
+	const char* query_text;
+	size_t text_length;
+	size_t param_count;
+	uint64_t rows; // rows fetched so far
+	uint64_t bytes; // bytes transferred, 0 if the backend does not report it
+	clock::time_point start;
+	clock::time_point finish;
+	bool failed;
+};
+
+/*
+	Receives events of all connections, so it should be thread safe if connections are used by several threads.
+	It is called on the thread which runs the query, so it should return quickly.
+ */
+class query_observer
+{
+public:
+	virtual ~query_observer() { }
+	virtual void on_query_event(const query_event& event) = 0;
+};
+
+namespace detail
+{
+
+inline std::atomic<query_observer*>& current_query_observer()
+{
+	static std::atomic<query_observer*> observer(nullptr);
+	return observer;
+}
+
+}
+
+// Registers the observer of queries and returns the previous one, nullptr stops observing.
+inline query_observer* set_query_observer(query_observer* observer)
+{
+	return detail::current_query_observer().exchange(observer);
+}
+
+#endif //QTL_ENABLE_TRACE
+
+namespace detail
+{
+
+// Count of parameters bound by params_binder, records with a custom binder are counted as one.
+template<typename T>
+struct param_count : public std::integral_constant<size_t, 1> { };
+
+template<typename... Types>
+struct param_count<std::tuple<Types...>> : public std::integral_constant<size_t, sizeof...(Types)> { };
+
+template<typename Type1, typename Type2>
+struct param_count<std::pair<Type1, Type2>> : public std::integral_constant<size_t, 2> { };
+
+#ifdef QTL_ENABLE_TRACE
+
+/*
+	Collects the events of a query and sends them to the observer registered when the query started.
+	It is copied along the handlers of asynchronous queries, so it keeps its own copy of the query text.
+ */
+class query_trace
+{
+public:
+	query_trace(const char* query_text, size_t text_length, size_t param_count)
+		: m_observer(current_query_observer().load(std::memory_order_acquire))
+	{
+		if(m_observer==nullptr) return;
+		m_text.assign(query_text, text_length);
+		m_event.phase=query_phase::prepare;
+		m_event.query_text=nullptr;
+		m_event.text_length=text_length;
+		m_event.param_count=param_count;
+		m_event.rows=0;
+		m_event.bytes=0;
+		m_event.failed=false;
+	}
+
+	void start(query_phase phase)
+	{
+		if(m_observer==nullptr) return;
+		m_event.phase=phase;
+		m_event.start=query_event::clock::now();
+	}
+	void finish(bool failed=false)
+	{
+		if(m_observer==nullptr) return;
+		m_event.finish=query_event::clock::now();
+		m_event.failed=failed;
+		notify(m_event);
+	}
+	void row(uint64_t bytes=0)
+	{
+		if(m_observer==nullptr) return;
+		m_event.bytes+=bytes;
+		if(++m_event.rows==1)
+		{
+			query_event event=m_event;
+			event.phase=query_phase::first_row;
+			event.finish=query_event::clock::now();
+			event.failed=false;
+			notify(event);
+		}
+	}
+
+	// Reports a failed phase if the guarded code throws.
+	class guard final
+	{
+	public:
+		guard(query_trace& trace, query_phase phase) : m_trace(trace), m_finished(false)
+		{
+			m_trace.start(phase);
+		}
+		guard(const guard&) = delete;
+		guard& operator=(const guard&) = delete;
+		~guard()
+		{
+			if(!m_finished) m_trace.finish(true);
+		}
+		void finish()
+		{
+			m_finished=true;
+			m_trace.finish();
+		}
+
+	private:
+		query_trace& m_trace;
+		bool m_finished;
+	};
+
+private:
+	query_observer* m_observer;
+	std::string m_text;
+	query_event m_event;
+
+	void notify(query_event& event)
+	{
+		event.query_text=m_text.data();
+		m_observer->on_query_event(event);
+	}
+};
+
+#else
+
+// Tracing is disabled, all hooks are empty and compile away.
+class query_trace
+{
+public:
+	query_trace(const char* /*query_text*/, size_t /*text_length*/, size_t /*param_count*/) { }
+
+	void start(query_phase /*phase*/) { }
+	void finish(bool /*failed*/=false) { }
+	void row(uint64_t /*bytes*/=0) { }
+
+	class guard final
+	{
+	public:
+		guard(query_trace& /*trace*/, query_phase /*phase*/) { }
+		guard(const guard&) = delete;
+		guard& operator=(const guard&) = delete;
+		void finish() { }
+	};
+};
+
+#endif //QTL_ENABLE_TRACE
+
+// Fetch phase of rows read by iterators, it finishes at the end of the rows or when the rows are abandoned.
+class fetch_trace final
+{
+public:
+	explicit fetch_trace(query_trace&& trace) : m_trace(std::move(trace)), m_fetching(false) { }
+	fetch_trace(fetch_trace&& src) : m_trace(std::move(src.m_trace)), m_fetching(src.m_fetching)
+	{
+		src.m_fetching=false;
+	}
+	fetch_trace& operator=(fetch_trace&& src)
+	{
+		if(this!=&src)
+		{
+			finish();
+			m_trace=std::move(src.m_trace);
+			m_fetching=src.m_fetching;
+			src.m_fetching=false;
+		}
+		return *this;
+	}
+	~fetch_trace()
+	{
+		finish();
+	}
+
+	void start()
+	{
+		if(m_fetching) return;
+		m_fetching=true;
+		m_trace.start(query_phase::fetch);
+	}
+	void row()
+	{
+		m_trace.row();
+	}
+	void finish(bool failed=false)
+	{
+		if(!m_fetching) return;
+		m_fetching=false;
+		m_trace.finish(failed);
+	}
+
+private:
+	query_trace m_trace;
+	bool m_fetching;
+};
+
+}
+
+}
+
+#endif //_QTL_TRACE_H_
@@ -0,0 +1,244 @@
+#include <stdio.h>
+#include <string.h>
+#include "Benchmark.h"
+#include "../include/qtl_mysql.hpp"
+
+using namespace std;
+
+static const char* create_table="create table bench(id bigint primary key, name varchar(32) not null, value double not null) engine=InnoDB";
+static const char* insert_row="insert into bench(id, name, value) values(?, ?, ?)";
+static const char* select_row="select name, value from bench where id=?";
+static const char* select_all="select id, name, value from bench";
+
+// Results are accumulated here so the compiler can not drop the fetched values.
+static volatile double sink;
+
+// Prepared statement of the native API, it binds parameters from a row.
+class native_statement
+{
+public:
+	native_statement(MYSQL* db, const char* query_text) : m_stmt(mysql_stmt_init(db))
+	{
+		memset(m_params, 0, sizeof(m_params));
+		if(m_stmt==NULL || mysql_stmt_prepare(m_stmt, query_text, static_cast<unsigned long>(strlen(query_text))))
+			throw_error();
+	}
+	~native_statement()
+	{
+		mysql_stmt_close(m_stmt);
+	}
+	native_statement(const native_statement&) = delete;
+	native_statement& operator=(const native_statement&) = delete;
+
+	operator MYSQL_STMT*() { return m_stmt; }
+
+	void bind(const Benchmark::row_type& row)
+	{
+		m_params[0].buffer_type=MYSQL_TYPE_LONGLONG;
+		m_params[0].buffer=const_cast<int64_t*>(&get<0>(row));
+		m_params[1].buffer_type=MYSQL_TYPE_STRING;
+		m_params[1].buffer=const_cast<char*>(get<1>(row).data());
+		m_params[1].buffer_length=static_cast<unsigned long>(get<1>(row).size());
+		m_params[2].buffer_type=MYSQL_TYPE_DOUBLE;
+		m_params[2].buffer=const_cast<double*>(&get<2>(row));
+		if(mysql_stmt_bind_param(m_stmt, m_params))
+			throw_error();
+	}
+	void bind(int64_t& key)
+	{
+		m_params[0].buffer_type=MYSQL_TYPE_LONGLONG;
+		m_params[0].buffer=&key;
+		if(mysql_stmt_bind_param(m_stmt, m_params))
+			throw_error();
+	}
+	void execute()
+	{
+		if(mysql_stmt_execute(m_stmt))
+			throw_error();
+	}
+	void throw_error()
+	{
+		throw qtl::mysql::error(mysql_stmt_errno(m_stmt), mysql_stmt_error(m_stmt));
+	}
+
+private:
+	MYSQL_STMT* m_stmt;
+	MYSQL_BIND m_params[3];
+};
+
+// Exposes the parameter binding of qtl, so it can be timed without executing the statement.
+class bind_statement : public qtl::mysql::statement
+{
+public:
+	bind_statement(qtl::mysql::database& db, const char* query_text) : statement(db)
+	{
+		open(query_text);
+	}
+
+	template<typename Params>
+	void bind(const Params& params)
+	{
+		resize_binders(get_parameter_count());
+		qtl::bind_params(*this, params);
+		if(mysql_stmt_bind_param(m_stmt, m_binders.data()))
+			throw_exception();
+	}
+};
+
+static void native_insert(MYSQL* db, const vector<Benchmark::row_type>& data)
+{
+	mysql_autocommit(db, 0);
+	{
+		native_statement stmt(db, insert_row);
+		for(const Benchmark::row_type& row : data)
+		{
+			stmt.bind(row);
+			stmt.execute();
+		}
+	}
+	mysql_commit(db);
+	mysql_autocommit(db, 1);
+}
+
+static void run_suite(Benchmark& bench, const char* host, const char* user, const char* password, const char* database)
+{
+	qtl::mysql::database db;
+	if(!db.open(host, user, password, database))
+		throw qtl::mysql::error(db);
+	db.simple_execute("drop table if exists bench");
+	db.simple_execute(create_table);
+	MYSQL* handle=db.handle();
+	const vector<Benchmark::row_type>& data=bench.data();
+	const vector<int64_t>& keys=bench.keys();
+
+	bench.print_header("mysql");
+
+	auto clear=[&db]() { db.simple_execute("truncate table bench"); };
+	bench.run("insert", data.size(), clear, [&]() {
+		db.begin_transaction();
+		qtl::mysql::statement stmt=db.open_command(insert_row);
+		for(const Benchmark::row_type& row : data)
+		{
+			stmt.reset();
+			stmt.execute(row);
+		}
+		stmt.close();
+		db.commit();
+	}, [&]() {
+		native_insert(handle, data);
+	});
+	bench.run("insert batch", data.size(), clear, [&]() {
+		db.begin_transaction();
+		db.execute_batch(insert_row, data);
+		db.commit();
+	}, [&]() {
+		native_insert(handle, data);
+	});
+
+	db.set_statement_cache_size(4);
+	bench.run("point select", keys.size(), [&]() {
+		string name;
+		double value=0;
+		for(int64_t key : keys)
+		{
+			db.query_first(select_row, make_tuple(key), tie(name, value));
+			sink=sink+value;
+		}
+	}, [&]() {
+		native_statement stmt(handle, select_row);
+		char name[33];
+		unsigned long length=0;
+		double value=0;
+		MYSQL_BIND fields[2];
+		memset(fields, 0, sizeof(fields));
+		fields[0].buffer_type=MYSQL_TYPE_STRING;
+		fields[0].buffer=name;
+		fields[0].buffer_length=sizeof(name);
+		fields[0].length=&length;
+		fields[1].buffer_type=MYSQL_TYPE_DOUBLE;
+		fields[1].buffer=&value;
+		for(int64_t key : keys)
+		{
+			stmt.bind(key);
+			stmt.execute();
+			if(mysql_stmt_bind_result(stmt, fields))
+				stmt.throw_error();
+			while(mysql_stmt_fetch(stmt)==0)
+				sink=sink+value;
+			mysql_stmt_free_result(stmt);
+		}
+	});
+
+	bench.run("full scan", data.size(), [&]() {
+		double total=0;
+		db.query(select_all, [&total](int64_t id, const string& name, double value) {
+			total+=id+name.size()+value;
+		});
+		sink=total;
+	}, [&]() {
+		native_statement stmt(handle, select_all);
+		int64_t id=0;
+		char name[33];
+		unsigned long length=0;
+		double value=0, total=0;
+		MYSQL_BIND fields[3];
+		memset(fields, 0, sizeof(fields));
+		fields[0].buffer_type=MYSQL_TYPE_LONGLONG;
+		fields[0].buffer=&id;
+		fields[1].buffer_type=MYSQL_TYPE_STRING;
+		fields[1].buffer=name;
+		fields[1].buffer_length=sizeof(name);
+		fields[1].length=&length;
+		fields[2].buffer_type=MYSQL_TYPE_DOUBLE;
+		fields[2].buffer=&value;
+		stmt.execute();
+		if(mysql_stmt_bind_result(stmt, fields))
+			stmt.throw_error();
+		while(mysql_stmt_fetch(stmt)==0)
+			total+=id+length+value;
+		mysql_stmt_free_result(stmt);
+		sink=total;
+	});
+
+	bench.run("bind parameters", keys.size(), [&]() {
+		bind_statement stmt(db, "select ?, ?, ?");
+		for(size_t i=0; i!=keys.size(); i++)
+			stmt.bind(data[i%data.size()]);
+	}, [&]() {
+		native_statement stmt(handle, "select ?, ?, ?");
+		for(size_t i=0; i!=keys.size(); i++)
+			stmt.bind(data[i%data.size()]);
+	});
+
+	db.simple_execute("drop table bench");
+}
+
+/*
+	Runs against a local server, the connection can be changed by arguments:
+	-h host -u user -p password -d database
+ */
+int main(int argc, char* argv[])
+{
+	const char* host="localhost";
+	const char* user="root";
+	const char* password="";
+	const char* database="test";
+	for(int i=1; i+1<argc; i+=2)
+	{
+		if(strcmp(argv[i], "-h")==0) host=argv[i+1];
+		else if(strcmp(argv[i], "-u")==0) user=argv[i+1];
+		else if(strcmp(argv[i], "-p")==0) password=argv[i+1];
+		else if(strcmp(argv[i], "-d")==0) database=argv[i+1];
+	}
+	Benchmark bench(argc, argv);
+	try
+	{
+		run_suite(bench, host, user, password, database);
+	}
+	catch(qtl::mysql::error& e)
+	{
+		fprintf(stderr, "%s\n", e.what());
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,259 @@
+#include <stdio.h>
+#include <string.h>
+#include "Benchmark.h"
+#include "../include/qtl_postgres.hpp"
+
+using namespace std;
+
+static const char* create_table="create table bench(id bigint primary key, name varchar(32) not null, value double precision not null)";
+static const char* insert_row="insert into bench(id, name, value) values($1, $2, $3)";
+static const char* select_row="select name, value from bench where id=$1";
+static const char* select_all="select id, name, value from bench";
+static const char* select_params="select $1::int8, $2::text, $3::float8";
+
+// Results are accumulated here so the compiler can not drop the fetched values.
+static volatile double sink;
+
+static uint64_t swap_bytes(uint64_t v)
+{
+	const unsigned char* p=reinterpret_cast<const unsigned char*>(&v);
+	uint64_t r=0;
+	for(int i=0; i!=8; i++)
+		r=(r<<8)|p[i];
+	return r;
+}
+
+static int64_t get_int64(const char* value)
+{
+	uint64_t v;
+	memcpy(&v, value, sizeof(v));
+	return static_cast<int64_t>(swap_bytes(v));
+}
+
+static double get_double(const char* value)
+{
+	uint64_t v;
+	memcpy(&v, value, sizeof(v));
+	v=swap_bytes(v);
+	double d;
+	memcpy(&d, &v, sizeof(d));
+	return d;
+}
+
+// Parameters of a row in binary format, as the native API sends them.
+struct native_params
+{
+	uint64_t id;
+	uint64_t value;
+	const char* values[3];
+	int lengths[3];
+	int formats[3];
+
+	native_params()
+	{
+		values[0]=reinterpret_cast<const char*>(&id);
+		values[2]=reinterpret_cast<const char*>(&value);
+		lengths[0]=lengths[2]=sizeof(uint64_t);
+		formats[0]=formats[1]=formats[2]=1;
+	}
+	void bind(const Benchmark::row_type& row)
+	{
+		id=swap_bytes(static_cast<uint64_t>(get<0>(row)));
+		memcpy(&value, &get<2>(row), sizeof(value));
+		value=swap_bytes(value);
+		values[1]=get<1>(row).data();
+		lengths[1]=static_cast<int>(get<1>(row).size());
+	}
+};
+
+static void check(PGconn* conn, PGresult* res, ExecStatusType status)
+{
+	if(res==NULL || PQresultStatus(res)!=status)
+	{
+		qtl::postgres::error e(conn);
+		PQclear(res);
+		throw e;
+	}
+}
+
+static void native_prepare(PGconn* conn, const char* name, const char* query_text)
+{
+	PGresult* res=PQprepare(conn, name, query_text, 0, NULL);
+	check(conn, res, PGRES_COMMAND_OK);
+	PQclear(res);
+}
+
+static void native_deallocate(PGconn* conn, const char* name)
+{
+	string text("deallocate ");
+	text+=name;
+	PQclear(PQexec(conn, text.data()));
+}
+
+static void native_insert(PGconn* conn, const vector<Benchmark::row_type>& data)
+{
+	native_params params;
+	PQclear(PQexec(conn, "begin"));
+	native_prepare(conn, "bench_insert", insert_row);
+	for(const Benchmark::row_type& row : data)
+	{
+		params.bind(row);
+		PGresult* res=PQexecPrepared(conn, "bench_insert", 3, params.values, params.lengths, params.formats, 1);
+		check(conn, res, PGRES_COMMAND_OK);
+		PQclear(res);
+	}
+	native_deallocate(conn, "bench_insert");
+	PQclear(PQexec(conn, "commit"));
+}
+
+// Exposes the parameter binding of qtl, so it can be timed without executing the statement.
+class bind_statement : public qtl::postgres::statement
+{
+public:
+	bind_statement(qtl::postgres::database& db, const char* query_text) : statement(db)
+	{
+		open(query_text);
+	}
+
+	template<typename Params>
+	void bind(const Params& params)
+	{
+		reset_params(qtl::params_binder<statement, Params>::size);
+		qtl::bind_params(*this, params);
+	}
+};
+
+static void run_suite(Benchmark& bench, const char* host, const char* user, const char* password, const char* database)
+{
+	qtl::postgres::database db;
+	if(!db.open(host, user, password, 5432U, database))
+		throw qtl::postgres::error(db.handle());
+	db.simple_execute("drop table if exists bench");
+	db.simple_execute(create_table);
+	PGconn* conn=db.handle();
+	const vector<Benchmark::row_type>& data=bench.data();
+	const vector<int64_t>& keys=bench.keys();
+
+	bench.print_header("postgres");
+
+	auto clear=[&db]() { db.simple_execute("truncate table bench"); };
+	bench.run("insert", data.size(), clear, [&]() {
+		db.begin_transaction();
+		{
+			qtl::postgres::statement stmt=db.open_command(insert_row);
+			for(const Benchmark::row_type& row : data)
+			{
+				stmt.reset();
+				stmt.execute(row);
+			}
+		}
+		db.commit();
+	}, [&]() {
+		native_insert(conn, data);
+	});
+	bench.run("insert batch", data.size(), clear, [&]() {
+		db.begin_transaction();
+		db.execute_batch(insert_row, data);
+		db.commit();
+	}, [&]() {
+		native_insert(conn, data);
+	});
+
+	db.set_statement_cache_size(4);
+	bench.run("point select", keys.size(), [&]() {
+		string name;
+		double value=0;
+		for(int64_t key : keys)
+		{
+			db.query_first(select_row, make_tuple(key), tie(name, value));
+			sink=sink+value;
+		}
+	}, [&]() {
+		string name;
+		native_prepare(conn, "bench_select", select_row);
+		for(int64_t key : keys)
+		{
+			uint64_t id=swap_bytes(static_cast<uint64_t>(key));
+			const char* values[1]={ reinterpret_cast<const char*>(&id) };
+			int lengths[1]={ sizeof(id) };
+			int formats[1]={ 1 };
+			PGresult* res=PQexecPrepared(conn, "bench_select", 1, values, lengths, formats, 1);
+			check(conn, res, PGRES_TUPLES_OK);
+			if(PQntuples(res)>0)
+			{
+				name.assign(PQgetvalue(res, 0, 0), PQgetlength(res, 0, 0));
+				sink=sink+get_double(PQgetvalue(res, 0, 1));
+			}
+			PQclear(res);
+		}
+		native_deallocate(conn, "bench_select");
+	});
+
+	bench.run("full scan", data.size(), [&]() {
+		double total=0;
+		db.query(select_all, [&total](int64_t id, const string& name, double value) {
+			total+=id+name.size()+value;
+		});
+		sink=total;
+	}, [&]() {
+		string name;
+		double total=0;
+		native_prepare(conn, "bench_scan", select_all);
+		PGresult* res=PQexecPrepared(conn, "bench_scan", 0, NULL, NULL, NULL, 1);
+		check(conn, res, PGRES_TUPLES_OK);
+		int rows=PQntuples(res);
+		for(int i=0; i!=rows; i++)
+		{
+			int64_t id=get_int64(PQgetvalue(res, i, 0));
+			name.assign(PQgetvalue(res, i, 1), PQgetlength(res, i, 1));
+			total+=id+name.size()+get_double(PQgetvalue(res, i, 2));
+		}
+		PQclear(res);
+		native_deallocate(conn, "bench_scan");
+		sink=total;
+	});
+
+	// The statement is prepared once, so only the binding is timed as in the native case.
+	bind_statement bind_stmt(db, select_params);
+	bench.run("bind parameters", keys.size(), [&]() {
+		for(size_t i=0; i!=keys.size(); i++)
+			bind_stmt.bind(data[i%data.size()]);
+	}, [&]() {
+		native_params params;
+		for(size_t i=0; i!=keys.size(); i++)
+			params.bind(data[i%data.size()]);
+		sink=static_cast<double>(params.id);
+	});
+
+	db.simple_execute("drop table bench");
+}
+
+/*
+	Runs against a local server, the connection can be changed by arguments:
+	-h host -u user -p password -d database
+ */
+int main(int argc, char* argv[])
+{
+	const char* host="localhost";
+	const char* user="postgres";
+	const char* password="111111";
+	const char* database="test";
+	for(int i=1; i+1<argc; i+=2)
+	{
+		if(strcmp(argv[i], "-h")==0) host=argv[i+1];
+		else if(strcmp(argv[i], "-u")==0) user=argv[i+1];
+		else if(strcmp(argv[i], "-p")==0) password=argv[i+1];
+		else if(strcmp(argv[i], "-d")==0) database=argv[i+1];
+	}
+	Benchmark bench(argc, argv);
+	try
+	{
+		run_suite(bench, host, user, password, database);
+	}
+	catch(qtl::postgres::error& e)
+	{
+		fprintf(stderr, "%s\n", e.what());
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,157 @@
+#include <stdio.h>
+#include <string.h>
+#include "Benchmark.h"
+#include "../include/qtl_sqlite.hpp"
+
+using namespace std;
+
+static const char* create_table="create table bench(id integer primary key, name text not null, value real not null)";
+static const char* insert_row="insert into bench(id, name, value) values(?, ?, ?)";
+static const char* select_row="select name, value from bench where id=?";
+static const char* select_all="select id, name, value from bench";
+
+// Results are accumulated here so the compiler can not drop the fetched values.
+static volatile double sink;
+
+static void check(sqlite3* db, int result)
+{
+	if(result!=SQLITE_OK && result!=SQLITE_ROW && result!=SQLITE_DONE)
+		throw qtl::sqlite::error(db);
+}
+
+static void native_insert(sqlite3* db, const vector<Benchmark::row_type>& data)
+{
+	sqlite3_stmt* stmt=NULL;
+	check(db, sqlite3_exec(db, "BEGIN TRANSACTION", NULL, NULL, NULL));
+	check(db, sqlite3_prepare_v2(db, insert_row, -1, &stmt, NULL));
+	for(const Benchmark::row_type& row : data)
+	{
+		sqlite3_bind_int64(stmt, 1, get<0>(row));
+		sqlite3_bind_text(stmt, 2, get<1>(row).data(), static_cast<int>(get<1>(row).size()), SQLITE_STATIC);
+		sqlite3_bind_double(stmt, 3, get<2>(row));
+		check(db, sqlite3_step(stmt));
+		sqlite3_reset(stmt);
+	}
+	sqlite3_finalize(stmt);
+	check(db, sqlite3_exec(db, "COMMIT TRANSACTION", NULL, NULL, NULL));
+}
+
+static void run_suite(Benchmark& bench, const char* filename)
+{
+	qtl::sqlite::database db;
+	remove(filename);
+	db.open(filename);
+	db.simple_execute(create_table);
+	sqlite3* handle=db.handle();
+	const vector<Benchmark::row_type>& data=bench.data();
+	const vector<int64_t>& keys=bench.keys();
+
+	printf("\n");
+	bench.print_header(filename);
+
+	auto clear=[&db]() { db.simple_execute("delete from bench"); };
+	bench.run("insert", data.size(), clear, [&]() {
+		db.begin_transaction();
+		qtl::sqlite::statement stmt=db.open_command(insert_row);
+		for(const Benchmark::row_type& row : data)
+		{
+			stmt.reset();
+			stmt.execute(row);
+		}
+		stmt.close();
+		db.commit();
+	}, [&]() {
+		native_insert(handle, data);
+	});
+	bench.run("insert batch", data.size(), clear, [&]() {
+		db.execute_batch(insert_row, data, data.size());
+	}, [&]() {
+		native_insert(handle, data);
+	});
+
+	db.set_statement_cache_size(4);
+	bench.run("point select", keys.size(), [&]() {
+		string name;
+		double value=0;
+		for(int64_t key : keys)
+		{
+			db.query_first(select_row, make_tuple(key), tie(name, value));
+			sink=sink+value;
+		}
+	}, [&]() {
+		sqlite3_stmt* stmt=NULL;
+		string name;
+		double value=0;
+		check(handle, sqlite3_prepare_v2(handle, select_row, -1, &stmt, NULL));
+		for(int64_t key : keys)
+		{
+			sqlite3_bind_int64(stmt, 1, key);
+			if(sqlite3_step(stmt)==SQLITE_ROW)
+			{
+				name.assign(reinterpret_cast<const char*>(sqlite3_column_text(stmt, 0)), sqlite3_column_bytes(stmt, 0));
+				value=sqlite3_column_double(stmt, 1);
+			}
+			sqlite3_reset(stmt);
+			sink=sink+value;
+		}
+		sqlite3_finalize(stmt);
+	});
+
+	bench.run("full scan", data.size(), [&]() {
+		double total=0;
+		db.query(select_all, [&total](int64_t id, const string& name, double value) {
+			total+=id+name.size()+value;
+		});
+		sink=total;
+	}, [&]() {
+		sqlite3_stmt* stmt=NULL;
+		string name;
+		double total=0;
+		check(handle, sqlite3_prepare_v2(handle, select_all, -1, &stmt, NULL));
+		while(sqlite3_step(stmt)==SQLITE_ROW)
+		{
+			int64_t id=sqlite3_column_int64(stmt, 0);
+			name.assign(reinterpret_cast<const char*>(sqlite3_column_text(stmt, 1)), sqlite3_column_bytes(stmt, 1));
+			double value=sqlite3_column_double(stmt, 2);
+			total+=id+name.size()+value;
+		}
+		sqlite3_finalize(stmt);
+		sink=total;
+	});
+
+	bench.run("bind parameters", keys.size(), [&]() {
+		qtl::sqlite::statement stmt=db.open_command("select ?, ?, ?");
+		for(size_t i=0; i!=keys.size(); i++)
+			qtl::bind_params(stmt, data[i%data.size()]);
+	}, [&]() {
+		sqlite3_stmt* stmt=NULL;
+		check(handle, sqlite3_prepare_v2(handle, "select ?, ?, ?", -1, &stmt, NULL));
+		for(size_t i=0; i!=keys.size(); i++)
+		{
+			const Benchmark::row_type& row=data[i%data.size()];
+			sqlite3_bind_int64(stmt, 1, get<0>(row));
+			sqlite3_bind_text(stmt, 2, get<1>(row).data(), static_cast<int>(get<1>(row).size()), SQLITE_STATIC);
+			sqlite3_bind_double(stmt, 3, get<2>(row));
+		}
+		sqlite3_finalize(stmt);
+	});
+
+	db.close();
+	remove(filename);
+}
+
+int main(int argc, char* argv[])
+{
+	Benchmark bench(argc, argv);
+	try
+	{
+		run_suite(bench, ":memory:");
+		run_suite(bench, "bench.db");
+	}
+	catch(qtl::sqlite::error& e)
+	{
+		fprintf(stderr, "%s\n", e.what());
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,111 @@
+#ifndef _BENCHMARK_H_
+#define _BENCHMARK_H_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <chrono>
+#include <vector>
+#include <string>
+#include <tuple>
+#include <random>
+#include <algorithm>
+#include <functional>
+
+/*
+	Runs each case implemented by qtl and by the native API of a backend,
+	and reports the overhead of qtl as the ratio of their median times.
+	Options:
+		-n rows		count of rows in the table, default 10000
+		-q queries	count of point queries and parameter bindings, default 10000
+		-r runs		count of timed runs of each case, default 5
+	Data and the order of point queries are generated from a fixed seed, so runs are comparable.
+ */
+class Benchmark
+{
+public:
+	typedef std::tuple<int64_t, std::string, double> row_type;
+	typedef std::function<void()> action_type;
+
+	Benchmark(int argc, char* argv[]) : m_rows(10000), m_queries(10000), m_runs(5)
+	{
+		for(int i=1; i+1<argc; i+=2)
+		{
+			size_t value=strtoul(argv[i+1], NULL, 10);
+			if(value==0) continue;
+			if(strcmp(argv[i], "-n")==0) m_rows=value;
+			else if(strcmp(argv[i], "-q")==0) m_queries=value;
+			else if(strcmp(argv[i], "-r")==0) m_runs=value;
+		}
+		std::mt19937 engine(20240101);
+		std::uniform_real_distribution<double> values(0.0, 1000.0);
+		m_data.reserve(m_rows);
+		for(size_t i=0; i!=m_rows; i++)
+		{
+			char name[32];
+			sprintf(name, "name %08u", static_cast<unsigned>(engine()%100000000));
+			m_data.emplace_back(static_cast<int64_t>(i+1), name, values(engine));
+		}
+		std::uniform_int_distribution<int64_t> ids(1, static_cast<int64_t>(m_rows));
+		m_keys.reserve(m_queries);
+		for(size_t i=0; i!=m_queries; i++)
+			m_keys.push_back(ids(engine));
+	}
+
+	size_t rows() const { return m_rows; }
+	size_t queries() const { return m_queries; }
+	const std::vector<row_type>& data() const { return m_data; }
+	// Keys of point queries, in random order.
+	const std::vector<int64_t>& keys() const { return m_keys; }
+
+	void print_header(const char* backend) const
+	{
+		printf("%s: %u rows, %u queries, %u runs\n", backend,
+			static_cast<unsigned>(m_rows), static_cast<unsigned>(m_queries), static_cast<unsigned>(m_runs));
+		printf("%-28s %14s %14s %12s %12s %8s\n", "case", "qtl ops/s", "native ops/s", "qtl us/op", "native us/op", "ratio");
+	}
+
+	/*
+		Times operations done by qtl and by the native API, setup is called before each run and is not timed.
+		Ratio is the median time of qtl divided by the median time of the native API.
+	 */
+	void run(const char* name, size_t operations, const action_type& setup, const action_type& qtl, const action_type& native)
+	{
+		double qtl_time=measure(setup, qtl);
+		double native_time=measure(setup, native);
+		printf("%-28s %14.0f %14.0f %12.3f %12.3f %8.3f\n", name,
+			operations/qtl_time, operations/native_time,
+			qtl_time*1e6/operations, native_time*1e6/operations, qtl_time/native_time);
+		fflush(stdout);
+	}
+	void run(const char* name, size_t operations, const action_type& qtl, const action_type& native)
+	{
+		run(name, operations, []() { }, qtl, native);
+	}
+
+private:
+	size_t m_rows;
+	size_t m_queries;
+	size_t m_runs;
+	std::vector<row_type> m_data;
+	std::vector<int64_t> m_keys;
+
+	// Returns the median time of runs in seconds, the first run warms up caches and is not counted.
+	double measure(const action_type& setup, const action_type& action)
+	{
+		std::vector<double> times;
+		for(size_t i=0; i<=m_runs; i++)
+		{
+			setup();
+			auto start=std::chrono::steady_clock::now();
+			action();
+			std::chrono::duration<double> elapsed=std::chrono::steady_clock::now()-start;
+			if(i>0) times.push_back(elapsed.count());
+		}
+		std::sort(times.begin(), times.end());
+		return times[times.size()/2];
+	}
+};
+
+#endif //_BENCHMARK_H_
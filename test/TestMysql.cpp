@@ -5,6 +5,7 @@
 #include <iomanip>
 #include "md5.h"
 #include "../include/qtl_mysql.hpp"
+#include "../include/qtl_mysql_loader.hpp"
 
 using namespace std;
 
@@ -48,6 +49,8 @@ TestMysql::TestMysql()
 	TEST_ADD(TestMysql::test_insert_blob)
 	TEST_ADD(TestMysql::test_select_blob)
 	TEST_ADD(TestMysql::test_any)
+	TEST_ADD(TestMysql::test_fetch_mode)
+	TEST_ADD(TestMysql::test_load_data)
 		//TEST_ADD(TestMysql::test_insert_stream)
 	//TEST_ADD(TestMysql::test_fetch_stream)
 }
@@ -361,6 +364,73 @@ void TestMysql::test_any()
 #endif
 }
 
+void TestMysql::test_fetch_mode()
+{
+	qtl::mysql::database db;
+	connect(db);
+
+	try
+	{
+		const char* query_text = "with recursive s(i) as (select 1 union all select i+1 from s where i<100) "
+			"select i, if(i%2=0, null, repeat('x', i*20)) from s";
+		const qtl::mysql::fetch_mode modes[] = {
+			qtl::mysql::fetch_mode::unbuffered,
+			qtl::mysql::fetch_mode::buffered,
+			qtl::mysql::fetch_mode::cursor
+		};
+		for (qtl::mysql::fetch_mode mode : modes)
+		{
+			int64_t total = 0;
+			size_t rows = 0;
+			db.set_fetch_mode(mode, 7);
+			db.query(query_text, [&total, &rows](int32_t i, const qtl::indicator<std::string>& text) {
+				total += i;
+				if (text.is_null == (i % 2 == 0) && text.data.size() == static_cast<size_t>(text.is_null ? 0 : i * 20)) ++rows;
+			});
+			TEST_ASSERT_MSG(total == 5050 && rows == 100, "Rows are not fetched in all modes.");
+		}
+
+		qtl::mysql::statement stmt = db.open_command(query_text);
+		stmt.set_fetch_mode(qtl::mysql::fetch_mode::buffered);
+		stmt.execute();
+		TEST_ASSERT_MSG(stmt.get_row_count() == 100, "Count of buffered rows is wrong.");
+	}
+	catch (qtl::mysql::error& e)
+	{
+		ASSERT_EXCEPTION(e);
+	}
+}
+
+void TestMysql::test_load_data()
+{
+	qtl::mysql::database db;
+	unsigned int local_infile = 1;
+	db.options(MYSQL_OPT_LOCAL_INFILE, &local_infile);
+	connect(db);
+
+	try
+	{
+		db.simple_execute("delete from test where Name like 'load\t%'");
+		std::vector<std::tuple<std::string, qtl::mysql::time>> rows;
+		for (int i = 0; i != 1000; i++)
+			rows.emplace_back("load\t" + std::to_string(i) + "\\\n", qtl::mysql::time(::time(NULL)));
+		qtl::mysql::bulk_loader loader(4096);
+		uint64_t affected = loader.load(db, "test(Name, CreateTime)", rows);
+		TEST_ASSERT_MSG(affected == rows.size(), "Rows are not loaded.");
+
+		size_t found = 0;
+		db.query("select Name from test where Name like 'load\t%'", [&found](const std::string& name) {
+			if (name.size() > 2 && name.compare(name.size() - 2, 2, "\\\n") == 0) ++found;
+		});
+		TEST_ASSERT_MSG(found == rows.size(), "Loaded values are not escaped.");
+		db.simple_execute("delete from test where Name like 'load\t%'");
+	}
+	catch (qtl::mysql::error& e)
+	{
+		ASSERT_EXCEPTION(e);
+	}
+}
+
 int main(int argc, char* argv[])
 {
 	Test::TextOutput output(Test::TextOutput::Verbose);
@@ -29,6 +29,8 @@ private:
 	void test_insert_stream();
 	void test_fetch_stream();
 	void test_any();
+	void test_fetch_mode();
+	void test_load_data();
 
 private:
 	uint32_t id;
@@ -6,6 +6,7 @@
 #include <iomanip>
 #include "md5.h"
 #include "../include/qtl_postgres.hpp"
+#include "../include/qtl_postgres_arrow.hpp"
 
 using namespace std;
 
@@ -49,6 +50,16 @@ TestPostgres::TestPostgres()
 	TEST_ADD(TestPostgres::test_insert_blob)
 	TEST_ADD(TestPostgres::test_select_blob)
 	TEST_ADD(TestPostgres::test_any)
+	TEST_ADD(TestPostgres::test_prepared_statements)
+	TEST_ADD(TestPostgres::test_prepare_threshold)
+	TEST_ADD(TestPostgres::test_fetch_mode)
+	TEST_ADD(TestPostgres::test_arrow)
+	TEST_ADD(TestPostgres::test_copy_writer)
+	TEST_ADD(TestPostgres::test_copy_reader)
+#ifdef LIBPQ_HAS_PIPELINING
+	TEST_ADD(TestPostgres::test_pipeline)
+	TEST_ADD(TestPostgres::test_batch_failure)
+#endif //LIBPQ_HAS_PIPELINING
 }
 
 inline void TestPostgres::connect(qtl::postgres::database& db)
@@ -337,6 +348,269 @@ void TestPostgres::test_any()
 #endif
 }
 
+void TestPostgres::test_prepared_statements()
+{
+	qtl::postgres::database db;
+	connect(db);
+
+	try
+	{
+		int32_t value = 0;
+		int64_t count = 0;
+		db.set_prepared_statement_limit(2);
+		db.query_first("select $1::int4", make_tuple(1), value);
+		db.query_first("select $1::int4", make_tuple(2), value);
+		db.query_first("select count(*) from pg_prepared_statements", count);
+		TEST_ASSERT_MSG(value == 2 && count == 2, "Statements are not reused.");
+
+		// evicts "select $1::int4", which is deallocated by flush
+		db.query_first("select 3", value);
+		db.flush_deallocations();
+		db.query_first("select count(*) from pg_prepared_statements where statement=$1", make_tuple("select $1::int4"), count);
+		TEST_ASSERT_MSG(count == 0, "Evicted statement is not deallocated.");
+	}
+	catch (qtl::postgres::error& e)
+	{
+		ASSERT_EXCEPTION(e);
+	}
+}
+
+void TestPostgres::test_prepare_threshold()
+{
+	qtl::postgres::database db;
+	connect(db);
+
+	try
+	{
+		int32_t value = 0;
+		int64_t count = 0;
+		db.set_prepare_threshold(2);
+		db.query_first("select $1::int4", make_tuple(1), value);
+		db.set_prepare_threshold(0);
+		db.query_first("select count(*) from pg_prepared_statements", count);
+		TEST_ASSERT_MSG(value == 1 && count == 0, "Statement is prepared before the threshold.");
+
+		db.set_prepare_threshold(2);
+		db.query_first("select $1::int4", make_tuple(2), value);
+		db.query_first("select $1::int4", make_tuple(3), value);
+		db.set_prepare_threshold(0);
+		db.query_first("select count(*) from pg_prepared_statements", count);
+		TEST_ASSERT_MSG(value == 3 && count == 1, "Statement is not prepared at the threshold.");
+	}
+	catch (qtl::postgres::error& e)
+	{
+		ASSERT_EXCEPTION(e);
+	}
+}
+
+void TestPostgres::test_fetch_mode()
+{
+	qtl::postgres::database db;
+	connect(db);
+
+	try
+	{
+		const qtl::postgres::fetch_mode modes[] = {
+			qtl::postgres::fetch_mode::single_row,
+			qtl::postgres::fetch_mode::chunked,
+			qtl::postgres::fetch_mode::buffered
+		};
+		for (qtl::postgres::fetch_mode mode : modes)
+		{
+			int64_t total = 0;
+			size_t rows = 0;
+			db.set_fetch_mode(mode, 7);
+			db.query("select i, case when i % 2 = 0 then null else i end from generate_series(1, 100) i",
+				[&total, &rows](int32_t i, const qtl::indicator<int32_t>& odd) {
+				total += i;
+				if (odd.is_null == (i % 2 == 0)) ++rows;
+			});
+			TEST_ASSERT_MSG(total == 5050 && rows == 100, "Rows are not fetched in all modes.");
+		}
+	}
+	catch (qtl::postgres::error& e)
+	{
+		ASSERT_EXCEPTION(e);
+	}
+}
+
+void TestPostgres::test_arrow()
+{
+	qtl::postgres::database db;
+	connect(db);
+
+	try
+	{
+		const qtl::postgres::fetch_mode modes[] = {
+			qtl::postgres::fetch_mode::single_row,
+			qtl::postgres::fetch_mode::chunked,
+			qtl::postgres::fetch_mode::buffered
+		};
+		for (qtl::postgres::fetch_mode mode : modes)
+		{
+			db.set_fetch_mode(mode, 7);
+			qtl::postgres::statement stmt = db.open_command("select i from generate_series(1, 100) i");
+			stmt.execute(std::make_tuple());
+			qtl::postgres::arrow_reader reader(stmt);
+			int64_t rows = 0, total = 0;
+			ArrowArray batch;
+			while (reader.read(&batch, 16) > 0)
+			{
+				const int32_t* values = static_cast<const int32_t*>(batch.children[0]->buffers[1]);
+				for (int64_t i = 0; i != batch.length; i++)
+					total += values[i];
+				rows += batch.length;
+				batch.release(&batch);
+			}
+			TEST_ASSERT_MSG(rows == 100 && total == 5050, "Rows are not read into Arrow arrays in all modes.");
+		}
+	}
+	catch (qtl::postgres::error& e)
+	{
+		ASSERT_EXCEPTION(e);
+	}
+}
+
+void TestPostgres::test_copy_writer()
+{
+	qtl::postgres::database db;
+	connect(db);
+
+	try
+	{
+		db.simple_execute("create temp table copy_test(id int4, name text)");
+		{
+			qtl::postgres::copy_writer writer(db, "copy copy_test(id, name) from stdin (format binary)", 256);
+			for (int32_t i = 0; i != 1000; i++)
+			{
+				if (i % 10 == 0)
+					writer.write(make_tuple(i, nullptr));
+				else
+					writer.write(make_tuple(i, std::string("row ") + std::to_string(i)));
+			}
+			TEST_ASSERT_MSG(writer.end() == 1000, "Not all rows are copied.");
+		}
+		int64_t count = 0;
+		db.query_first("select count(name) from copy_test", count);
+		TEST_ASSERT_MSG(count == 900, "Null fields are not copied.");
+
+		// a row of a wrong type fails when the copy ends
+		qtl::postgres::copy_writer writer(db, "copy copy_test(id, name) from stdin (format binary)");
+		writer.write(make_tuple(int64_t(1), std::string("wrong")));
+		bool failed = false;
+		try
+		{
+			writer.end();
+		}
+		catch (qtl::postgres::error&)
+		{
+			failed = true;
+		}
+		TEST_ASSERT_MSG(failed, "Failed row is not reported.");
+	}
+	catch (qtl::postgres::error& e)
+	{
+		ASSERT_EXCEPTION(e);
+	}
+}
+
+void TestPostgres::test_copy_reader()
+{
+	qtl::postgres::database db;
+	connect(db);
+
+	try
+	{
+		int64_t total = 0;
+		size_t nulls = 0;
+		db.copy_to("copy (select i, case when i % 10 = 0 then null else 'row ' || i end from generate_series(1, 1000) i) to stdout (format binary)",
+			[&total, &nulls](int32_t i, const qtl::indicator<std::string>& name) {
+			total += i;
+			if (name.is_null) ++nulls;
+		});
+		TEST_ASSERT_MSG(total == 500500 && nulls == 100, "Rows are not read from copy data.");
+
+		// stopping early cancels the copy, the connection is still usable
+		size_t rows = 0;
+		db.copy_to("copy (select i from generate_series(1, 100000) i) to stdout (format binary)", [&rows](int32_t) {
+			return ++rows < 10;
+		});
+		int32_t value = 0;
+		db.query_first("select 1", value);
+		TEST_ASSERT_MSG(rows == 10 && value == 1, "Copy is not cancelled.");
+	}
+	catch (qtl::postgres::error& e)
+	{
+		ASSERT_EXCEPTION(e);
+	}
+}
+
+#ifdef LIBPQ_HAS_PIPELINING
+
+void TestPostgres::test_pipeline()
+{
+	qtl::postgres::database db;
+	connect(db);
+
+	try
+	{
+		int32_t first = 0, last = 0;
+		uint64_t affected = 0;
+		qtl::postgres::pipeline pipeline(db);
+		pipeline.query("select $1::int4", make_tuple(1), [&first](int32_t value) { first = value; });
+		pipeline.execute("update test set Name=Name where ID=$1", make_tuple(id), [&affected](const qtl::postgres::error& e, uint64_t n) {
+			affected = n;
+		});
+		pipeline.query("select $1::int4", make_tuple(3), [&last](int32_t value) { last = value; });
+		TEST_ASSERT_MSG(first == 0 && pipeline.pending() > 0, "Results are received before sync.");
+		pipeline.sync();
+		TEST_ASSERT_MSG(first == 1 && last == 3 && pipeline.pending() == 0, "Results are not dispatched in order.");
+
+		// a failed query aborts the rest of the pipeline
+		bool failed = false, aborted = false;
+		pipeline.execute("select 1/$1", make_tuple(0), [&failed](const qtl::postgres::error& e, uint64_t) { failed = e; });
+		pipeline.execute("select $1::int4", make_tuple(1), [&aborted](const qtl::postgres::error& e, uint64_t) { aborted = e; });
+		pipeline.sync();
+		TEST_ASSERT_MSG(failed && aborted, "Failed query does not abort the pipeline.");
+	}
+	catch (qtl::postgres::error& e)
+	{
+		ASSERT_EXCEPTION(e);
+	}
+}
+
+void TestPostgres::test_batch_failure()
+{
+	qtl::postgres::database db;
+	connect(db);
+
+	try
+	{
+		db.simple_execute("create temp table batch_test(id int4 primary key)");
+		std::vector<std::tuple<int32_t>> rows = { make_tuple(1), make_tuple(2), make_tuple(2), make_tuple(3) };
+		bool failed = false;
+		try
+		{
+			db.execute_batch("insert into batch_test values($1)", rows, 2);
+		}
+		catch (qtl::postgres::error&)
+		{
+			failed = true;
+		}
+		TEST_ASSERT_MSG(failed, "Duplicate key in a batch is not reported.");
+		// the connection leaves pipeline mode, the first batch is committed
+		int64_t count = 0;
+		db.query_first("select count(*) from batch_test", count);
+		TEST_ASSERT_MSG(count == 2, "Connection is not usable after a failed batch.");
+	}
+	catch (qtl::postgres::error& e)
+	{
+		ASSERT_EXCEPTION(e);
+	}
+}
+
+#endif //LIBPQ_HAS_PIPELINING
+
 void TestPostgres::get_md5(std::istream& is, unsigned char* result)
 {
 	std::array<char, 64 * 1024> buffer;
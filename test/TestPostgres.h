@@ -27,6 +27,14 @@ private:
 	void test_insert_blob();
 	void test_select_blob();
 	void test_any();
+	void test_prepared_statements();
+	void test_prepare_threshold();
+	void test_fetch_mode();
+	void test_arrow();
+	void test_copy_writer();
+	void test_copy_reader();
+	void test_pipeline();
+	void test_batch_failure();
 
 private:
 	int32_t id;
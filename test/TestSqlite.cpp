@@ -6,6 +6,8 @@
 #include "md5.h"
 #include "TestSqlite.h"
 #include "../include/qtl_sqlite.hpp"
+#include "../include/qtl_sqlite_arrow.hpp"
+#include "../include/qtl_sqlite_pool.hpp"
 
 using namespace std;
 
@@ -49,6 +51,14 @@ TestSqlite::TestSqlite()
 	TEST_ADD(TestSqlite::test_insert_blob)
 	TEST_ADD(TestSqlite::test_select_blob)
 	TEST_ADD(TestSqlite::test_any)
+	TEST_ADD(TestSqlite::test_statement_cache)
+	TEST_ADD(TestSqlite::test_batch)
+	TEST_ADD(TestSqlite::test_query_all)
+	TEST_ADD(TestSqlite::test_columnar)
+	TEST_ADD(TestSqlite::test_arrow)
+	TEST_ADD(TestSqlite::test_trace)
+	TEST_ADD(TestSqlite::test_pool)
+	TEST_ADD(TestSqlite::test_pool_checks)
 }
 
 inline qtl::sqlite::database TestSqlite::connect()
@@ -276,6 +286,292 @@ void TestSqlite::test_any()
 #endif // C++17
 }
 
+void TestSqlite::test_statement_cache()
+{
+	qtl::sqlite::database db = connect();
+
+	try
+	{
+		db.set_statement_cache_size(4);
+		for(int i=0; i!=10; i++)
+		{
+			int64_t count=0;
+			db.query_first("select count(*) from test where id>?", make_tuple(i), forward_as_tuple(count));
+		}
+		TEST_ASSERT_MSG(db.statement_cache_stats().misses==1, "statement is not cached.");
+		TEST_ASSERT_MSG(db.statement_cache_stats().hits==9, "cached statement is not reused.");
+	}
+	catch(qtl::sqlite::error& e)
+	{
+		ASSERT_EXCEPTION(e);
+	}
+}
+
+void TestSqlite::test_batch()
+{
+	qtl::sqlite::database db = connect();
+
+	try
+	{
+		std::vector<std::tuple<std::string>> names;
+		for(int i=0; i!=25; i++)
+			names.emplace_back("batch_user_"+std::to_string(i));
+		std::vector<uint64_t> affected=db.execute_batch("insert into test(Name, CreateTime) values(?, datetime('now'))", names, 10);
+		TEST_ASSERT_MSG(affected.size()==3 && affected[0]==10 && affected[2]==5, "Cannot insert records in batch.");
+	}
+	catch(qtl::sqlite::error& e)
+	{
+		ASSERT_EXCEPTION(e);
+	}
+}
+
+void TestSqlite::test_query_all()
+{
+	qtl::sqlite::database db = connect();
+
+	try
+	{
+		std::vector<TestSqliteRecord> records;
+		db.query_all("select ID, Name, strftime('%s', CreateTime) from test", records);
+		int64_t count=0;
+		db.query_first("select count(*) from test", count);
+		TEST_ASSERT_MSG(records.size()==static_cast<size_t>(count), "Cannot fetch all records.");
+	}
+	catch(qtl::sqlite::error& e)
+	{
+		ASSERT_EXCEPTION(e);
+	}
+}
+
+void TestSqlite::test_columnar()
+{
+	qtl::sqlite::database db = connect();
+
+	try
+	{
+		qtl::columnar<int64_t, std::string> columns;
+		db.query_explicit("select ID, Name from test union all select NULL, NULL", columns, 
+			[](qtl::columnar<int64_t, std::string>&) { });
+		int64_t count=0;
+		db.query_first("select count(*) from test", count);
+		TEST_ASSERT_MSG(columns.size()==static_cast<size_t>(count)+1, "Cannot fetch all records.");
+		TEST_ASSERT_MSG(columns.column<0>().size()==columns.size() && columns.column<1>().size()==columns.size(), 
+			"Columns have different sizes.");
+		TEST_ASSERT_MSG(columns.is_null(0, count) && columns.is_null(1, count), "Null field is not marked.");
+		TEST_ASSERT_MSG(count==0 || !columns.is_null(0, 0), "Field is marked null.");
+	}
+	catch(qtl::sqlite::error& e)
+	{
+		ASSERT_EXCEPTION(e);
+	}
+}
+
+void TestSqlite::test_arrow()
+{
+	qtl::sqlite::database db = connect();
+
+	try
+	{
+		qtl::sqlite::statement stmt=db.open_command("select ID, Name from test");
+		stmt.execute(std::make_tuple());
+		qtl::sqlite::arrow_reader reader(stmt);
+		ArrowSchema schema;
+		reader.get_schema(&schema);
+		TEST_ASSERT_MSG(schema.n_children==2, "Schema has wrong count of columns.");
+		ArrowSchema name_column=*schema.children[1];
+		schema.children[1]->release=NULL;
+		schema.release(&schema);
+		TEST_ASSERT_MSG(strcmp(name_column.name, "Name")==0, "Moved column has lost its name.");
+		name_column.release(&name_column);
+		int64_t rows=0;
+		ArrowArray batch;
+		while(reader.read(&batch, 3)>0)
+		{
+			TEST_ASSERT_MSG(batch.n_children==2 && batch.children[0]->length==batch.length, 
+				"Columns have wrong length.");
+			rows+=batch.length;
+			batch.release(&batch);
+		}
+		TEST_ASSERT_MSG(batch.release==NULL, "Empty batch is not released.");
+		int64_t count=0;
+		db.query_first("select count(*) from test", count);
+		TEST_ASSERT_MSG(rows==count, "Cannot read all records.");
+	}
+	catch(qtl::sqlite::error& e)
+	{
+		ASSERT_EXCEPTION(e);
+	}
+}
+
+#ifdef QTL_ENABLE_TRACE
+
+struct TestSqliteObserver : public qtl::query_observer
+{
+	std::vector<qtl::query_event> events;
+
+	virtual void on_query_event(const qtl::query_event& event) override
+	{
+		events.push_back(event);
+	}
+};
+
+#endif //QTL_ENABLE_TRACE
+
+void TestSqlite::test_trace()
+{
+#ifdef QTL_ENABLE_TRACE
+	qtl::sqlite::database db = connect();
+	TestSqliteObserver observer;
+
+	try
+	{
+		int64_t count=0;
+		db.query_first("select count(*) from test", count);
+		qtl::set_query_observer(&observer);
+		db.query("select ID from test where ID>?", std::make_tuple(0), [](int64_t) { });
+		qtl::set_query_observer(nullptr);
+		std::vector<qtl::query_phase> phases;
+		for(const qtl::query_event& event : observer.events)
+		{
+			phases.push_back(event.phase);
+			TEST_ASSERT_MSG(event.param_count==1 && event.finish>=event.start && !event.failed, "Event is wrong.");
+		}
+		TEST_ASSERT_MSG(phases.size()>=3 && phases[0]==qtl::query_phase::prepare && 
+			phases[1]==qtl::query_phase::execute && phases.back()==qtl::query_phase::fetch, "Phases are wrong.");
+		TEST_ASSERT_MSG(observer.events.back().rows==static_cast<uint64_t>(count), "Count of rows is wrong.");
+
+		observer.events.clear();
+		qtl::set_query_observer(&observer);
+		{
+			auto rows=db.result<std::tuple<int64_t>>("select ID from test where ID>?", std::make_tuple(0));
+			for(auto it=rows.begin(); it!=rows.end(); ++it);
+		}
+		qtl::set_query_observer(nullptr);
+		TEST_ASSERT_MSG(observer.events.back().phase==qtl::query_phase::fetch && 
+			observer.events.back().rows==static_cast<uint64_t>(count), "Rows read by iterators are not traced.");
+	}
+	catch(qtl::sqlite::error& e)
+	{
+		qtl::set_query_observer(nullptr);
+		ASSERT_EXCEPTION(e);
+	}
+#endif //QTL_ENABLE_TRACE
+}
+
+struct TestSqlitePool : public qtl::sqlite::database_pool
+{
+	TestSqlitePool()
+	{
+		m_filename="test.db";
+		set_size_limits(1, 2);
+	}
+};
+
+void TestSqlite::test_pool()
+{
+	TestSqlitePool pool;
+	TEST_ASSERT_MSG(pool.warm_up() && pool.size()==1, "Failed to warm up the pool.");
+	TestSqlitePool::pointer db1=pool.get();
+	TestSqlitePool::pointer db2=pool.get();
+	TEST_ASSERT_MSG(db1 && db2 && pool.size()==2, "Failed to get connections.");
+	TEST_ASSERT_MSG(!pool.get(), "Pool exceeds its max size.");
+	TEST_ASSERT_MSG(!pool.get(std::chrono::milliseconds(10)), "Waiting should time out.");
+
+	std::thread releaser([&db1]() {
+		std::this_thread::sleep_for(std::chrono::milliseconds(50));
+		db1.reset();
+	});
+	TestSqlitePool::pointer db3=pool.get(std::chrono::seconds(10));
+	releaser.join();
+	TEST_ASSERT_MSG(db3 && pool.size()==2, "Failed to wait for a connection.");
+
+	qtl::pool_metrics metrics=pool.metrics();
+	TEST_ASSERT_MSG(metrics.in_use==2 && metrics.idle==0 && metrics.connect_time.count==2 &&
+		metrics.acquire_time.count==5 && metrics.acquire_failures==2, "Metrics are wrong.");
+
+	TestSqlitePool::pointer db4;
+	std::thread waiting([&pool, &db4]() {
+		db4=pool.get(std::chrono::seconds(10));
+	});
+	while(pool.metrics().waiting==0)
+		std::this_thread::yield();
+	db2.reset();
+	waiting.join();
+	TEST_ASSERT_MSG(db4 && pool.metrics().idle==0, "Returned connection should be handed to the waiting thread.");
+}
+
+// A connection which answers is_alive after a delay.
+struct TestSlowSqlite
+{
+	static std::atomic<int> delay_ms;
+	qtl::sqlite::database db;
+
+	bool is_alive()
+	{
+		std::this_thread::sleep_for(std::chrono::milliseconds(delay_ms.load()));
+		return db.is_alive();
+	}
+};
+
+std::atomic<int> TestSlowSqlite::delay_ms(0);
+
+struct TestSlowSqlitePool : public qtl::database_pool<TestSlowSqlite>
+{
+	TestSlowSqlitePool()
+	{
+		set_size_limits(0, 1);
+	}
+	virtual TestSlowSqlite* new_database() throw() override
+	{
+		TestSlowSqlite* db=NULL;
+		try
+		{
+			db=new TestSlowSqlite;
+			db->db.open("test.db");
+		}
+		catch(qtl::sqlite::error&)
+		{
+			delete db;
+			db=NULL;
+		}
+		return db;
+	}
+};
+
+void TestSqlite::test_pool_checks()
+{
+	TestSlowSqlite::delay_ms=0;
+	{
+		TestSlowSqlitePool pool;
+		pool.set_validate_after(std::chrono::hours(1));
+		pool.get().reset();
+		pool.get().reset();
+		TEST_ASSERT_MSG(pool.metrics().validations==0, "Recently used connection is validated.");
+		pool.set_validate_after(std::chrono::milliseconds(0));
+		pool.get().reset();
+		TEST_ASSERT_MSG(pool.metrics().validations==1, "Idle connection is not validated.");
+
+		// a check missing its deadline is abandoned, but the connection keeps its slot until it is closed
+		TestSlowSqlite::delay_ms=300;
+		pool.set_check_options(1, std::chrono::milliseconds(20));
+		TEST_ASSERT_MSG(!pool.test_alive(), "Slow check should fail.");
+		qtl::pool_metrics metrics=pool.metrics();
+		TEST_ASSERT_MSG(metrics.failed_validations==1 && pool.size()==1, "Abandoned connection has lost its slot.");
+		TEST_ASSERT_MSG(!pool.get(), "Pool opens a connection over an abandoned one.");
+		TestSlowSqlite::delay_ms=0;
+		std::this_thread::sleep_for(std::chrono::milliseconds(500));
+		TEST_ASSERT_MSG(pool.metrics().idle==0 && pool.get(), "Slot of abandoned connection is not freed.");
+	}
+	{
+		TestSlowSqlitePool pool;
+		pool.set_idle_timeout(std::chrono::milliseconds(50));
+		pool.get().reset();
+		TEST_ASSERT_MSG(pool.size()==1, "Returned connection is closed.");
+		std::this_thread::sleep_for(std::chrono::milliseconds(400));
+		TEST_ASSERT_MSG(pool.size()==0 && pool.metrics().evictions==1, "Idle connection is not evicted.");
+	}
+}
+
 void TestSqlite::get_md5(std::string& str, unsigned char* result)
 {
 	MD5_CTX context;
@@ -27,6 +27,14 @@ private:
 	void test_insert_blob();
 	void test_select_blob();
 	void test_any();
+	void test_statement_cache();
+	void test_batch();
+	void test_query_all();
+	void test_columnar();
+	void test_arrow();
+	void test_trace();
+	void test_pool();
+	void test_pool_checks();
 
 private:
 	int64_t id;
@@ -0,0 +1,17 @@
+TARGET=bench_mysql
+CC=g++
+OBJ=BenchMysql.o
+CFLAGS=-O2 -DNDEBUG -I../include -I/usr/include -I/usr/local/include $(shell mysql_config --cflags)
+CXXFLAGS=-std=c++11
+LDFLAGS= -L/usr/local/lib $(shell mysql_config --libs)
+
+all : $(TARGET)
+
+BenchMysql.o : BenchMysql.cpp Benchmark.h
+	$(CC) -c $(CFLAGS) $(CXXFLAGS) -o $@ $<
+
+$(TARGET) : $(OBJ)
+	$(CC) -o $@ $^ $(LDFLAGS)
+
+clean:
+	rm $(TARGET) $(OBJ) -f
@@ -0,0 +1,17 @@
+TARGET=bench_postgres
+CC=g++
+OBJ=BenchPostgres.o
+CFLAGS=-O2 -DNDEBUG -I/usr/include -I/usr/local/include -I$(shell pg_config --includedir) -I$(shell pg_config --includedir-server )
+CXXFLAGS= -I../include -std=c++11
+LDFLAGS= -L$(shell pg_config --libdir) -pthread -lpq -lpgtypes
+
+all : $(TARGET)
+
+BenchPostgres.o : BenchPostgres.cpp Benchmark.h
+	$(CC) -c $(CFLAGS) $(CXXFLAGS) -o $@ $<
+
+$(TARGET) : $(OBJ)
+	$(CC) -o $@ $^ $(LDFLAGS)
+
+clean:
+	rm $(TARGET) $(OBJ) -f
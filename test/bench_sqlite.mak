@@ -0,0 +1,19 @@
+TARGET=bench_sqlite
+CC=g++
+OBJ=BenchSqlite.o sqlite3.o
+CFLAGS=-O2 -DNDEBUG -I. -I../include -I/usr/local/include -std=c++11
+LDFLAGS= -L/usr/local/lib -ldl -lpthread
+
+all : $(TARGET)
+
+BenchSqlite.o : BenchSqlite.cpp Benchmark.h
+	$(CC) -c $(CFLAGS) -o $@ BenchSqlite.cpp
+
+sqlite3.o : sqlite3.c
+	gcc -c -O2 -I../include -o $@ $^
+
+$(TARGET) : $(OBJ)
+	$(CC) -o $@ $^ $(LDFLAGS)
+
+clean:
+	rm $(TARGET) BenchSqlite.o -f
@@ -3,7 +3,7 @@ CC=g++
 PCH_HEADER=stdafx.h
 PCH=stdafx.h.gch
 OBJ=TestSqlite.o sqlite3.o md5.o
-CFLAGS=-g -D_DEBUG -O2 -I. -I../include -I/usr/local/include -std=c++11
+CFLAGS=-g -D_DEBUG -DQTL_ENABLE_TRACE -O2 -I. -I../include -I/usr/local/include -std=c++11
 LDFLAGS= -L/usr/local/lib -ldl -lcpptest -lpthread
 
 all : $(TARGET)